@@ -139,7 +139,7 @@ public:
 
         value = volToNormalized(DB2VAL(value));
 
-        widget_->SetIncomingMessageTime(GetTickCount());
+        widget_->SetIncomingMessageTime(g_clock.GetMilliseconds());
         widget_->GetZoneManager()->DoAction(widget_, value);
     }
 };
@@ -165,7 +165,7 @@ public:
         else if (value < -10.0) value = (value + 50.0) /  80.0;
         else if (value <= 10.0) value = (value + 30.0) /  40.0;
 
-        if ((GetTickCount() - GetWidget()->GetLastIncomingMessageTime()) >= 30)
+        if ((g_clock.GetMilliseconds() - GetWidget()->GetLastIncomingMessageTime()) >= 30)
             surface_->SendOSCMessage(this, oscAddress_.c_str(), value);
     }
 };
@@ -17,14 +17,34 @@ class FXParam : public FXAction
 public:
     virtual const char* GetName() override { return "FXParam"; }
 
+    virtual void RequestUpdate(ActionContext* context) override
+    {
+        if (MediaTrack* track = context->GetTrack())
+        {
+            // only params that changed since this context last sent them are sent again, see CSIFXParamValueCache
+            int changeSerial = context->GetCSI()->GetFXParamValueCache().GetChangeSerial(track, context->GetSlotIndex(), context->GetParamIndex());
+            
+            if (context->GetIsFXParamFeedbackCurrent(changeSerial))
+                return;
+            
+            context->UpdateWidgetValue(GetCurrentNormalizedValue(context));
+            context->SetFXParamFeedbackSent(changeSerial);
+        }
+        else
+            context->ClearWidget();
+    }
+
     virtual void Do(ActionContext* context, double value) override
     {
         if (MediaTrack* track = context->GetTrack())
+        {
 #if defined(REAPERAPI_WANT_TrackFX_SetParamNormalized)
             TrackFX_SetParamNormalized(track, context->GetSlotIndex(), context->GetParamIndex(), value);
 #else
             TrackFX_SetParam(track, context->GetSlotIndex(), context->GetParamIndex(), value);
 #endif
+            context->GetCSI()->GetFXParamValueCache().OnParamChange(track, context->GetSlotIndex(), context->GetParamIndex());
+        }
     }
 
     virtual void Touch(ActionContext* context, double value) override
@@ -65,7 +85,7 @@ public:
         {
 #if defined(REAPERAPI_WANT_TrackFX_GetParamNormalized)
             // use host's normalized getter
-            return TrackFX_GetParamNormalized(
+            return context->GetCSI()->GetFXParamValueCache().GetParamNormalized(
                 track,
                 context->GetSlotIndex(),
                 context->GetParamIndex()
@@ -93,6 +113,11 @@ public:
     {
         if (MediaTrack* track = context->GetTrack())
         {
+            int changeSerial = context->GetCSI()->GetFXParamValueCache().GetChangeSerial(track, context->GetSlotIndex(), context->GetParamIndex());
+            
+            if (context->GetIsFXParamFeedbackCurrent(changeSerial))
+                return;
+            
             // update main widget
             context->UpdateWidgetValue(GetCurrentNormalizedValue(context));
 
@@ -102,7 +127,7 @@ public:
 #if defined(REAPERAPI_WANT_TrackFX_GetParamNormalized)
                 // normalized getter
                 context->UpdateJSFXWidgetSteppedValue(
-                    TrackFX_GetParamNormalized(
+                    context->GetCSI()->GetFXParamValueCache().GetParamNormalized(
                         track,
                         context->GetSlotIndex(),
                         context->GetParamIndex()
@@ -123,6 +148,8 @@ public:
                 context->UpdateJSFXWidgetSteppedValue(norm);
 #endif
             }
+            
+            context->SetFXParamFeedbackSent(changeSerial);
         }
         else
         {
@@ -142,6 +169,7 @@ public:
                 context->GetParamIndex(),
                 value
             );
+            context->GetCSI()->GetFXParamValueCache().OnParamChange(track, context->GetSlotIndex(), context->GetParamIndex());
 #else
             // fallback: raw setter with manual range mapping
             double min = 0.0, max = 0.0;
@@ -226,7 +254,7 @@ public:
                 if (GetTCPFXParm(NULL, track, index, &fxIndex, &paramIndex))
                 {
 #if defined(REAPERAPI_WANT_TrackFX_GetParamNormalized)
-                    return TrackFX_GetParamNormalized(track, fxIndex, paramIndex);
+                    return context->GetCSI()->GetFXParamValueCache().GetParamNormalized(track, fxIndex, paramIndex);
 #else
                     double raw = TrackFX_GetParam(track, fxIndex, paramIndex, &min, &max);
                     double range = max - min;
@@ -238,6 +266,30 @@ public:
         return 0.0;
     }
 
+    virtual void RequestUpdate(ActionContext* context) override
+    {
+        if (MediaTrack* track = context->GetTrack())
+        {
+            int index = context->GetIntParam();
+            int fxIndex = 0, paramIndex = 0;
+            if (CountTCPFXParms(NULL, track) > index && GetTCPFXParm(NULL, track, index, &fxIndex, &paramIndex))
+            {
+                CSIFXParamValueCache &fxParamValueCache = context->GetCSI()->GetFXParamValueCache();
+                int changeSerial = fxParamValueCache.GetChangeSerial(track, fxIndex, paramIndex);
+                
+                if (context->GetIsFXParamFeedbackCurrent(changeSerial))
+                    return;
+                
+                context->UpdateWidgetValue(fxParamValueCache.GetParamNormalized(track, fxIndex, paramIndex));
+                context->SetFXParamFeedbackSent(changeSerial);
+            }
+            else
+                context->UpdateWidgetValue(0.0);
+        }
+        else
+            context->ClearWidget();
+    }
+
     virtual void Do(ActionContext* context, double value) override
     {
         if (MediaTrack* track = context->GetTrack())
@@ -253,6 +305,7 @@ public:
 #else
                     TrackFX_SetParam(track, fxIndex, paramIndex, value);
 #endif
+                    context->GetCSI()->GetFXParamValueCache().OnParamChange(track, fxIndex, paramIndex);
                 }
             }
         }
@@ -275,7 +328,7 @@ public:
     virtual double GetCurrentNormalizedValue(ActionContext* context) override
     {
         int trackNum = 0, fxSlotNum = 0, fxParamNum = 0;
-        if (!GetLastTouchedFX(&trackNum, &fxSlotNum, &fxParamNum)) return 0.0;
+        if (!context->GetCSI()->GetLastTouchedFXParam(&trackNum, &fxSlotNum, &fxParamNum)) return 0.0;
         MediaTrack* track = DAW::GetTrack(trackNum);
         if (!track) return 0.0;
 #if defined(REAPERAPI_WANT_TrackFX_GetParamNormalized)
@@ -291,7 +344,7 @@ public:
     virtual void RequestUpdate(ActionContext* context) override
     {
         int trackNum = 0, fxSlotNum = 0, fxParamNum = 0;
-        if (!GetLastTouchedFX(&trackNum, &fxSlotNum, &fxParamNum))
+        if (!context->GetCSI()->GetLastTouchedFXParam(&trackNum, &fxSlotNum, &fxParamNum))
         {
             context->ClearWidget();
             return;
@@ -314,7 +367,7 @@ public:
     virtual void Do(ActionContext* context, double value) override
     {
         int trackNum = 0, fxSlotNum = 0, fxParamNum = 0;
-        if (!GetLastTouchedFX(&trackNum, &fxSlotNum, &fxParamNum)) return;
+        if (!context->GetCSI()->GetLastTouchedFXParam(&trackNum, &fxSlotNum, &fxParamNum)) return;
         MediaTrack* track = DAW::GetTrack(trackNum);
         if (!track) return;
 #if defined(REAPERAPI_WANT_TrackFX_SetParamNormalized)
@@ -327,7 +380,7 @@ public:
     virtual void Touch(ActionContext* context, double value) override
     {
         int trackNum = 0, fxSlotNum = 0, fxParamNum = 0;
-        if (!GetLastTouchedFX(&trackNum, &fxSlotNum, &fxParamNum)) return;
+        if (!context->GetCSI()->GetLastTouchedFXParam(&trackNum, &fxSlotNum, &fxParamNum)) return;
         MediaTrack* track = DAW::GetTrack(trackNum);
         if (!track) return;
 
@@ -2306,9 +2359,7 @@ public:
                 context->UpdateWidgetValue(context->GetFXParamDisplayName());
             else
             {
-                char tmp[MEDBUF];
-                TrackFX_GetParamName(track, context->GetSlotIndex(), context->GetParamIndex(), tmp, sizeof(tmp));
-                context->UpdateWidgetValue(tmp);
+                context->UpdateWidgetValue(context->GetCSI()->GetFXParamValueCache().GetParamName(track, context->GetSlotIndex(), context->GetParamIndex()));
             }
         }
         else
@@ -2359,9 +2410,7 @@ public:
     {
         if (MediaTrack *track = context->GetTrack())
         {
-            char fxParamValue[128];
-            TrackFX_GetFormattedParamValue(track, context->GetSlotIndex(), context->GetParamIndex(), fxParamValue, sizeof(fxParamValue));
-            context->UpdateWidgetValue(fxParamValue);
+            context->UpdateWidgetValue(context->GetCSI()->GetFXParamValueCache().GetFormattedParamValue(track, context->GetSlotIndex(), context->GetParamIndex()));
         }
         else
             context->ClearWidget();
@@ -2388,9 +2437,7 @@ public:
                 
                 if (GetTCPFXParm(NULL, track, index, &fxIndex, &paramIndex))
                 {
-                    char fxParamValue[128];
-                    TrackFX_GetFormattedParamValue(track, fxIndex, paramIndex, fxParamValue, sizeof(fxParamValue));
-                    context->UpdateWidgetValue(fxParamValue);
+                    context->UpdateWidgetValue(context->GetCSI()->GetFXParamValueCache().GetFormattedParamValue(track, fxIndex, paramIndex));
                 }
                 else
                     context->ClearWidget();
@@ -2416,13 +2463,11 @@ public:
         int fxSlotNum = 0;
         int fxParamNum = 0;
         
-        if (GetLastTouchedFX(&trackNum, &fxSlotNum, &fxParamNum))
+        if (context->GetCSI()->GetLastTouchedFXParam(&trackNum, &fxSlotNum, &fxParamNum))
         {
             if (MediaTrack *track = DAW::GetTrack(trackNum))
             {
-                char tmp[MEDBUF];
-                TrackFX_GetParamName(track, fxSlotNum, fxParamNum, tmp, sizeof(tmp));
-                context->UpdateWidgetValue(tmp);
+                context->UpdateWidgetValue(context->GetCSI()->GetFXParamValueCache().GetParamName(track, fxSlotNum, fxParamNum));
             }
         }
         else
@@ -2443,13 +2488,11 @@ public:
         int fxSlotNum = 0;
         int fxParamNum = 0;
         
-        if (GetLastTouchedFX(&trackNum, &fxSlotNum, &fxParamNum))
+        if (context->GetCSI()->GetLastTouchedFXParam(&trackNum, &fxSlotNum, &fxParamNum))
         {
             if (MediaTrack *track = DAW::GetTrack(trackNum))
             {
-                char fxParamValue[128];
-                TrackFX_GetFormattedParamValue(track, fxSlotNum, fxParamNum, fxParamValue, sizeof(fxParamValue));
-                context->UpdateWidgetValue(fxParamValue);
+                context->UpdateWidgetValue(context->GetCSI()->GetFXParamValueCache().GetFormattedParamValue(track, fxSlotNum, fxParamNum));
             }
         }
         else
@@ -85,7 +85,7 @@ public:
         if (MediaTrack *track = context->GetTrack())
         {
 #if defined(REAPERAPI_WANT_TrackFX_GetParamNormalized)
-            return TrackFX_GetParamNormalized(
+            return context->GetCSI()->GetFXParamValueCache().GetParamNormalized(
                 track,
                 context->GetSlotIndex(),
                 context->GetParamIndex()
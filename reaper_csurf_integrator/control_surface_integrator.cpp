@@ -32,6 +32,41 @@ bool g_surfaceOutDisplay;
 
 bool g_fxParamsWrite;
 
+int g_zoneStateChangeCount = 0; // bumped whenever the set of active zones or their action contexts may have changed
+
+bool g_isRunProfilerEnabled = false;
+bool g_isLatencyTracingEnabled = false;
+bool g_isSessionCaptureActive = false; // recording or replaying, see CSISessionCapture
+
+CSILogQueue g_logQueue;
+CSIClock g_clock;
+
+#ifdef CSI_ALLOCATION_COUNTING
+std::atomic<long long> g_numAllocations(0);
+
+void *operator new(size_t size)
+{
+    g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+    
+    if (void *p = malloc(size > 0 ? size : 1))
+        return p;
+    
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+#endif
+
+static const int s_maxLatencyTraceTime = 2000000; // us, an input whose feedback did not change by then is dropped
+
 void GetPropertiesFromTokens(int start, int finish, const vector<string> &tokens, PropertyList &properties)
 {
     for (int i = start; i < finish; ++i)
@@ -178,15 +213,20 @@ void GetParamStepsValues(vector<double> &outputVector, int numSteps)
         outputVector.push_back(EnumSteppedValues(numSteps, i));
 }
 
+// These run for every line of every .mst, .ost, .zon and CSI.ini file, so they work in place on the caller's buffer
+// and never go through a stringstream or a temporary copy of the line.
+// tests/csi_tokenizer_check.cpp checks them against the stream based originals.
+
 void TrimLine(string &line)
 {
-    const string tmp = line;
-    const char *p = tmp.c_str();
-
     // remove leading and trailing spaces
     // condense whitespace to single whitespace
     // stop copying at "//" (comment)
-    line.clear();
+    // the output is never longer than the input, so it is written over the line as it is read
+    char *buf = &line[0];
+    const char *p = buf;
+    char *out = buf;
+    
     for (;;)
     {
         // advance over whitespace
@@ -196,16 +236,19 @@ void TrimLine(string &line)
         // a single / at the beginning of a line indicates a comment
         if (!*p || p[0] == '/') break;
 
-        if (line.length())
-            line.append(" ",1);
+        if (out != buf)
+            *out++ = ' ';
 
         // copy non-whitespace to output
         while (*p && (*p < 0 || !isspace(*p)))
         {
            if (p[0] == '/' && p[1] == '/') break; // existing behavior, maybe not ideal, but a comment can start anywhere
-           line.append(p++,1);
+           *out++ = *p++;
         }
     }
+    
+    line.resize(out - buf);
+    
     if (!line.empty() && g_debugLevel > DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] %s\n", line.c_str());
 }
 
@@ -214,36 +257,153 @@ void ReplaceAllWith(string &output, const char *charsToReplace, const char *repl
     // replace all occurences of
     // any char in charsToReplace
     // with replacement string
-    const string tmp = output;
-    const char *p = tmp.c_str();
-    output.clear();
-
-    while (*p)
+    size_t numMatches = 0;
+    
+    for (size_t i = 0; i < output.size() && output[i]; ++i)
+        if (strchr(charsToReplace, output[i]) != NULL)
+            numMatches++;
+    
+    // like the original, stop at the first embedded null
+    size_t length = strlen(output.c_str());
+    
+    if (numMatches == 0)
+    {
+        output.resize(length);
+        return;
+    }
+    
+    size_t replacementLength = strlen(replacement);
+    size_t newLength = length + numMatches * replacementLength - numMatches;
+    
+    if (replacementLength <= 1)
+    {
+        // shrinking or same size, so copy forwards in place
+        size_t out = 0;
+        
+        for (size_t in = 0; in < length; ++in)
+        {
+            if (strchr(charsToReplace, output[in]) != NULL)
+            {
+                if (replacementLength)
+                    output[out++] = replacement[0];
+            }
+            else
+                output[out++] = output[in];
+        }
+    }
+    else
     {
-        if (strchr(charsToReplace, *p) != NULL)
+        // growing, so copy backwards in place
+        output.resize(newLength);
+        
+        size_t out = newLength;
+        
+        for (size_t in = length; in-- > 0; )
         {
-            output.append(replacement);
+            if (strchr(charsToReplace, output[in]) != NULL)
+            {
+                out -= replacementLength;
+                memcpy(&output[out], replacement, replacementLength);
+            }
+            else
+                output[--out] = output[in];
         }
-        else
-            output.append(p,1);
-        p++;
     }
+    
+    output.resize(newLength);
+}
+
+static bool IsTokenSpace(char c)
+{
+    // the classic locale whitespace that istream uses to separate tokens
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
 }
 
 void GetTokens(vector<string> &tokens, const string &line)
 {
-    istringstream iss(line);
-    string token;
-    while (iss >> quoted(token))
-        tokens.push_back(token);
+    // same tokens as istringstream >> quoted(): "quoted tokens" may contain whitespace and \ escapes,
+    // unquoted tokens run to the next whitespace, an unterminated quote drops the last token
+    const char *p = line.data();
+    const char *end = p + line.size();
+    
+    for (;;)
+    {
+        while (p < end && IsTokenSpace(*p))
+            p++;
+        
+        if (p >= end)
+            break;
+        
+        if (*p != '"')
+        {
+            const char *start = p;
+            
+            while (p < end && ! IsTokenSpace(*p))
+                p++;
+            
+            tokens.emplace_back(start, p - start);
+        }
+        else
+        {
+            p++;
+            
+            const char *start = p;
+            
+            while (p < end && *p != '"' && *p != '\\')
+                p++;
+            
+            tokens.emplace_back(start, p - start);
+            
+            bool isTerminated = false;
+            
+            while (p < end)
+            {
+                char c = *p++;
+                
+                if (c == '\\')
+                {
+                    if (p >= end)
+                        break;
+                    
+                    c = *p++;
+                }
+                else if (c == '"')
+                {
+                    isTerminated = true;
+                    break;
+                }
+                
+                tokens.back().push_back(c);
+            }
+            
+            if ( ! isTerminated)
+            {
+                tokens.pop_back();
+                break;
+            }
+        }
+    }
+
 }
 
 void GetTokens(vector<string> &tokens, const string &line, char delimiter)
 {
-    istringstream iss(line);
-    string token;
-    while (getline(iss, token, delimiter))
-        tokens.push_back(token);
+    // same tokens as getline() with a delimiter: empty tokens are kept, except after a trailing delimiter
+    size_t start = 0;
+    
+    while (start < line.size())
+    {
+        size_t delimiterPos = line.find(delimiter, start);
+        
+        if (delimiterPos == string::npos)
+        {
+            tokens.emplace_back(line, start);
+            break;
+        }
+        
+        tokens.emplace_back(line, start, delimiterPos - start);
+        start = delimiterPos + 1;
+    }
 }
 
 int strToHex(string &valueStr)
@@ -425,17 +585,6 @@ static oscpkt::UdpSocket *GetOutputSocketForAddressAndPort(const string &surface
     return NULL;
 }
 
-// files
-static void listFilesOfType(const string &path, vector<string> &results, const string &type)
-{
-    filesystem::path zonePath { path };
-    
-    if (filesystem::exists(path) && filesystem::is_directory(path))
-        for (auto &file : filesystem::recursive_directory_iterator(path))
-            if (file.path().extension() == type)
-                results.push_back(file.path().string());
-}
-
 //////////////////////////////////////////////////////////////////////////////
 // Midi_ControlSurface
 //////////////////////////////////////////////////////////////////////////////
@@ -1037,6 +1186,18 @@ void CSurfIntegrator::InitActionsDictionary()
     actions_.insert(make_pair("ToggleUseLocalModifiers", make_unique<ToggleUseLocalModifiers>()));
     actions_.insert(make_pair("ToggleUseLocalFXSlot", make_unique<ToggleUseLocalFXSlot>()));
     actions_.insert(make_pair("SetLatchTime", make_unique<SetLatchTime>()));
+    actions_.insert(make_pair("SetRefreshSweepRuns", make_unique<SetRefreshSweepRuns>()));
+    actions_.insert(make_pair("ToggleRunProfiler", make_unique<ToggleRunProfiler>()));
+    actions_.insert(make_pair("DumpRunProfiler", make_unique<DumpRunProfiler>()));
+    actions_.insert(make_pair("ToggleLatencyTracing", make_unique<ToggleLatencyTracing>()));
+    actions_.insert(make_pair("ToggleSessionCapture", make_unique<ToggleSessionCapture>()));
+    actions_.insert(make_pair("ReplaySession", make_unique<ReplaySession>()));
+    actions_.insert(make_pair("ReplaySessionFast", make_unique<ReplaySessionFast>()));
+    actions_.insert(make_pair("DumpMemoryFootprint", make_unique<DumpMemoryFootprint>()));
+    actions_.insert(make_pair("IOTelemetryDisplay", make_unique<IOTelemetryDisplay>()));
+    actions_.insert(make_pair("ToggleIOTelemetryOSC", make_unique<ToggleIOTelemetryOSC>()));
+    actions_.insert(make_pair("ResetIOTelemetry", make_unique<ResetIOTelemetry>()));
+    actions_.insert(make_pair("ToggleLogToFile", make_unique<ToggleLogToFile>()));
     actions_.insert(make_pair("SetHoldTime", make_unique<SetHoldTime>()));
     actions_.insert(make_pair("SetDoublePressTime", make_unique<SetDoublePressTime>()));
     actions_.insert(make_pair("ToggleEnableFocusedFXMapping", make_unique<ToggleEnableFocusedFXMapping>()));
@@ -1160,6 +1321,22 @@ void CSurfIntegrator::InitActionsDictionary()
 
 void CSurfIntegrator::Init()
 {
+    DWORD initStartTime = GetTickCount();
+    
+    if (zoneTemplateCache_.GetNumTemplates() == 0)
+        zoneTemplateCache_.LoadFromFile(GetZoneTemplateCacheFilePath());
+    
+    if (zoneManifestCache_.GetNumManifests() == 0)
+        zoneManifestCache_.LoadFromFile(GetZoneManifestCacheFilePath());
+    
+    zoneManifestCache_.InvalidateAll(); // each folder is rescanned once per Init, then shared
+    
+    zoneTemplateCache_.ResetStats();
+    zoneManifestCache_.ResetStats();
+    
+    // REAPER's "Control surface: Refresh all surfaces" stops a replay even when every surface is being replayed
+    sessionCapture_.StopReplay();
+    
     pages_.clear();
     
     string currentBroadcaster;
@@ -1478,6 +1655,11 @@ void CSurfIntegrator::Init()
 
         page->OnInitialization();
     }
+    
+    if (g_debugLevel >= DEBUG_LEVEL_INFO) LogToConsole(256, "[INFO] Init: %d pages in %d ms, zone files parsed %d, zone loads from shared templates %d, zone headers read %d, zone headers from manifest %d, template cache hit rate %.1f%%, templates prefetched %d\n", (int)pages_.size(), (int)(GetTickCount() - initStartTime), zoneTemplateCache_.GetNumCompiled(), zoneTemplateCache_.GetNumReused(), zoneManifestCache_.GetNumFilesRead(), zoneManifestCache_.GetNumFilesReused(), zoneTemplateCache_.GetHitRate(), zoneTemplateCache_.GetNumPrefetched());
+    
+    zoneTemplateCache_.SaveToFile(GetZoneTemplateCacheFilePath());
+    zoneManifestCache_.SaveToFile(GetZoneManifestCacheFilePath());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1732,17 +1914,37 @@ void ActionContext::UpdateWidgetValue(double value)
         UpdateTrackColor();
 }
 
+bool ActionContext::GetIsFXParamFeedbackCurrent(int changeSerial)
+{
+    return changeSerial == fxParamChangeSerial_ && widget_->GetNumFeedbackWrites() == fxParamWidgetWrites_;
+}
+
+void ActionContext::SetFXParamFeedbackSent(int changeSerial)
+{
+    fxParamChangeSerial_ = changeSerial;
+    fxParamWidgetWrites_ = widget_->GetNumFeedbackWrites();
+}
+
 void ActionContext::UpdateJSFXWidgetSteppedValue(double value)
 {
     if (steppedValues_.size() > 0)
         SetSteppedValueIndex(value);
 }
 
+size_t ActionContext::GetMemoryFootprint()
+{
+    return sizeof(ActionContext)
+        + CSIMemoryReport::GetStringBytes(stringParam_) + CSIMemoryReport::GetStringBytes(fxParamDisplayName_) + CSIMemoryReport::GetStringBytes(m_freeFormText)
+        + steppedValues_.capacity() * sizeof(double) + acceleratedDeltaValues_.capacity() * sizeof(double) + acceleratedTickValues_.capacity() * sizeof(int)
+        + colorValues_.capacity() * sizeof(rgba_color)
+        + widgetProperties_.get_heap_bytes();
+}
+
 void ActionContext::UpdateTrackColor()
 {
     if (MediaTrack* track = zone_->GetNavigator()->GetTrack())
     {
-        rgba_color color = DAW::GetTrackColor(track);
+        rgba_color color = GetPage()->GetTrackColor(track);
         widget_->UpdateColorValue(color);
     }
 }
@@ -1793,7 +1995,7 @@ void ActionContext::LogAction(double value)
 // runs once button pressed/released
 void ActionContext::DoAction(double value)
 {
-    DWORD nowTs = GetTickCount();
+    DWORD nowTs = g_clock.GetMilliseconds();
     int holdDelayMs = holdDelayMs_ == HOLD_DELAY_INHERIT_VALUE ? this->GetSurface()->GetHoldTime() : holdDelayMs_;
     deferredValue_ = value;
     
@@ -1824,38 +2026,77 @@ void ActionContext::DoAction(double value)
             holdActive_ = true;
             lastHoldStartTs_ = nowTs;
         }
+        ArmDeferredActionTimer();
     } else {
+        ArmDeferredActionTimer();
         PerformAction(value);
     }
 }
 
-// runs in loop to support button hold/repeat actions
+// arms the surface timer wheel for the next hold / repeat, or cancels it once neither is pending
+void ActionContext::ArmDeferredActionTimer()
+{
+    int holdDelayMs = holdDelayMs_ == HOLD_DELAY_INHERIT_VALUE ? this->GetSurface()->GetHoldTime() : holdDelayMs_;
+    
+    DWORD dueTime = 0;
+    
+    // + 1 because RunDeferredActions fires strictly after the delay
+    if (holdDelayMs > 0 && holdActive_ && lastHoldStartTs_ > 0)
+        dueTime = lastHoldStartTs_ + holdDelayMs + 1;
+    else if (holdRepeatIntervalMs_ > 0 && holdRepeatActive_ && lastHoldRepeatTs_ > 0)
+        dueTime = lastHoldRepeatTs_ + holdRepeatIntervalMs_ + 1;
+    
+    if (dueTime != 0)
+    {
+        timerWheel_ = &GetSurface()->GetTimerWheel();
+        timerWheel_->Arm(this, dueTime);
+    }
+    else if (timerWheel_ != NULL)
+    {
+        timerWheel_->Cancel(this);
+        timerWheel_ = NULL;
+    }
+}
+
+// called by the surface timer wheel when a hold / repeat timer armed by DoAction expires
 void ActionContext::RunDeferredActions()
 {
+    timerWheel_ = NULL;
+    
+    // the zone went away while the button was held
+    if (! zone_->GetIsActive())
+    {
+        holdActive_ = false;
+        holdRepeatActive_ = false;
+        return;
+    }
+    
     int holdDelayMs = holdDelayMs_ == HOLD_DELAY_INHERIT_VALUE ? this->GetSurface()->GetHoldTime() : holdDelayMs_;
 
     if (holdDelayMs > 0
         && holdActive_
         && lastHoldStartTs_ > 0
-        && GetTickCount() > (lastHoldStartTs_ + holdDelayMs)
+        && g_clock.GetMilliseconds() > (lastHoldStartTs_ + holdDelayMs)
     ) {
-        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] HOLD [%s] %d ms\n", GetWidget()->GetName(), GetTickCount() - lastHoldStartTs_);
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] HOLD [%s] %d ms\n", GetWidget()->GetName(), g_clock.GetMilliseconds() - lastHoldStartTs_);
         PerformAction(deferredValue_);
         holdActive_ = false; // to mark that this action with it's defined hold delay was performed and separate it from repeated action trigger
         if (holdRepeatIntervalMs_ > 0) {
             holdRepeatActive_ = true;
-            lastHoldRepeatTs_ = GetTickCount();
+            lastHoldRepeatTs_ = g_clock.GetMilliseconds();
         }
     }
     if (holdRepeatIntervalMs_ > 0
         && holdRepeatActive_
         && lastHoldRepeatTs_ > 0
-        && GetTickCount() > (lastHoldRepeatTs_ + holdRepeatIntervalMs_)
+        && g_clock.GetMilliseconds() > (lastHoldRepeatTs_ + holdRepeatIntervalMs_)
     ) {
-        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] REPEAT [%s] %d ms\n", GetWidget()->GetName(), GetTickCount() - lastHoldRepeatTs_);
-        lastHoldRepeatTs_ = GetTickCount();
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] REPEAT [%s] %d ms\n", GetWidget()->GetName(), g_clock.GetMilliseconds() - lastHoldRepeatTs_);
+        lastHoldRepeatTs_ = g_clock.GetMilliseconds();
         PerformAction(deferredValue_);
     }
+    
+    ArmDeferredActionTimer();
 }
 
 void ActionContext::PerformAction(double value)
@@ -2141,12 +2382,16 @@ int Zone::GetSlotIndex()
 
 void Zone::AddWidget(Widget *widget)
 {
+    g_zoneStateChangeCount++;
+    
     if (find(widgets_.begin(), widgets_.end(), widget) == widgets_.end())
         widgets_.push_back(widget);
 }
 
 void Zone::Activate()
 {
+    g_zoneStateChangeCount++;
+    
     UpdateCurrentActionContextModifiers();
     
     for (auto &widget : widgets_)
@@ -2180,6 +2425,9 @@ void Zone::Deactivate()
 {
     if (!isActive_)
         return;
+    
+    g_zoneStateChangeCount++;
+    
     for (auto &widget : widgets_)
     {
         for (auto &actionContext : GetActionContexts(widget))
@@ -2208,25 +2456,73 @@ void Zone::Deactivate()
         subZone->Deactivate();
 }
 
-void Zone::RequestUpdate()
+void Zone::AddToUpdatePlan(CSIUpdatePlan &updatePlan)
 {
     if (! isActive_)
         return;
     
     for (auto &subZone : subZones_)
-        subZone->RequestUpdate();
+        subZone->AddToUpdatePlan(updatePlan);
 
     for (auto &includedZone : includedZones_)
-        includedZone->RequestUpdate();
+        includedZone->AddToUpdatePlan(updatePlan);
+    
+    CSIUpdatePlanZone planZone;
+    planZone.zone = this;
+    planZone.firstEntry = (int)updatePlan.entries.size();
     
     for (auto widget : widgets_)
     {
         if ( ! widget->GetHasBeenUsedByUpdate())
         {
             widget->SetHasBeenUsedByUpdate();
-            RequestUpdateWidget(widget);
+            
+            CSIUpdatePlanEntry entry;
+            entry.widget = widget;
+            entry.actionContexts = &GetActionContexts(widget);
+            updatePlan.entries.push_back(entry);
+        }
+    }
+    
+    planZone.numEntries = (int)updatePlan.entries.size() - planZone.firstEntry;
+    
+    if (planZone.numEntries > 0)
+        updatePlan.zones.push_back(planZone);
+}
+
+void Zone::AddToMemoryReport(CSIMemoryReport &report, const char *category)
+{
+    size_t zoneBytes = sizeof(Zone) + CSIMemoryReport::GetStringBytes(name_) + CSIMemoryReport::GetStringBytes(alias_) + CSIMemoryReport::GetStringBytes(sourceFilePath_);
+    zoneBytes += widgets_.capacity() * sizeof(Widget *) + includedZones_.capacity() * sizeof(unique_ptr<Zone>) + subZones_.capacity() * sizeof(unique_ptr<Zone>);
+    zoneBytes += currentActionContextModifiers_.size() * (s_mapNodeOverhead + sizeof(pair<Widget *const, int>));
+    
+    int numActionContexts = 0;
+    size_t actionContextBytes = 0;
+    
+    for (auto &widgetContexts : actionContextDictionary_)
+    {
+        zoneBytes += s_mapNodeOverhead + sizeof(widgetContexts);
+        
+        for (auto &modifierContexts : widgetContexts.second)
+        {
+            zoneBytes += s_mapNodeOverhead + sizeof(modifierContexts) + modifierContexts.second.capacity() * sizeof(unique_ptr<ActionContext>);
+            
+            for (auto &context : modifierContexts.second)
+            {
+                numActionContexts++;
+                actionContextBytes += context->GetMemoryFootprint();
+            }
         }
     }
+    
+    report.Add(category, 1, zoneBytes);
+    report.Add("ActionContext", numActionContexts, actionContextBytes);
+    
+    for (auto &includedZone : includedZones_)
+        includedZone->AddToMemoryReport(report, "IncludedZone");
+
+    for (auto &subZone : subZones_)
+        subZone->AddToMemoryReport(report, "SubZone");
 }
 
 void Zone::SetXTouchDisplayColors(const char *colors)
@@ -2358,6 +2654,8 @@ void Zone::UpdateCurrentActionContextModifiers()
 
 void Zone::UpdateCurrentActionContextModifier(Widget *widget)
 {
+    g_zoneStateChangeCount++;
+    
     for(int i = 0; i < (int)widget->GetSurface()->GetModifiers().size(); ++i)
     {
         if(actionContextDictionary_[widget].count(widget->GetSurface()->GetModifiers()[i]) > 0)
@@ -2370,6 +2668,8 @@ void Zone::UpdateCurrentActionContextModifier(Widget *widget)
 
 ActionContext *Zone::AddActionContext(Widget *widget, int modifier, Zone *zone, const char *actionName, vector<string> &params)
 {
+    g_zoneStateChangeCount++;
+    
     actionContextDictionary_[widget][modifier].push_back(make_unique<ActionContext>(csi_, csi_->GetAction(actionName), widget, zone, 0, params));
     
     return actionContextDictionary_[widget][modifier].back().get();
@@ -2422,18 +2722,74 @@ void Widget::Configure(const vector<unique_ptr<ActionContext>> &contexts)
 
 void  Widget::UpdateValue(const PropertyList &properties, double value)
 {
+    isCleared_ = false;
+    numFeedbackWrites_++;
+    
+    bool hasFeedbackChanged = false;
+    
+    if (lastFeedbackValue_ != value)
+    {
+        lastFeedbackValue_ = value;
+        SetIsActive();
+        hasFeedbackChanged = true;
+    }
+    
     for (auto &feedbackProcessor : feedbackProcessors_)
         feedbackProcessor->SetValue(properties, value);
+    
+    if (latencyTraceId_ != 0)
+        FinishLatencyTrace(hasFeedbackChanged);
 }
 
 void  Widget::UpdateValue(const PropertyList &properties, const char * const &value)
 {
+    isCleared_ = false;
+    numFeedbackWrites_++;
+    
+    bool hasFeedbackChanged = false;
+    
+    // display text is updated every Run, comparing and copying it is only worth it when something uses the result
+    if (g_isLatencyTracingEnabled || surface_->GetRefreshSweepRuns() > 1)
+    {
+        if (lastFeedbackString_ != value)
+        {
+            lastFeedbackString_ = value;
+            SetIsActive();
+            hasFeedbackChanged = true;
+        }
+    }
+    
     for (auto &feedbackProcessor : feedbackProcessors_)
         feedbackProcessor->SetValue(properties, value);
+    
+    if (latencyTraceId_ != 0)
+        FinishLatencyTrace(hasFeedbackChanged);
+}
+
+void Widget::FinishLatencyTrace(bool hasFeedbackChanged)
+{
+    // feedback has been handed to the surface IO by now, sent directly or queued (see CSIIOTelemetry for queue age)
+    const int latency = (int)(GetProfilerMicroseconds() - latencyTraceStartTime_);
+    
+    if (hasFeedbackChanged)
+    {
+        csi_->RecordFeedbackLatency(GetLatencyTraceClass(), latency);
+        
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] Latency trace %d: %s %s %d us\n", latencyTraceId_, surface_->GetName(), GetName(), latency);
+    }
+    else if (latency > s_maxLatencyTraceTime)
+        csi_->OnLatencyTraceExpired();
+    else
+        return;
+    
+    latencyTraceId_ = 0;
 }
 
 void  Widget::ForceValue(const PropertyList &properties, const char * const &value)
 {
+    isCleared_ = false;
+    numFeedbackWrites_++;
+    
     for (auto &feedbackProcessor : feedbackProcessors_)
         feedbackProcessor->ForceValue(properties, value);
 }
@@ -2446,6 +2802,9 @@ void Widget::RunDeferredActions()
 
 void  Widget::UpdateColorValue(const rgba_color &color)
 {
+    isCleared_ = false;
+    numFeedbackWrites_++;
+    
     for (auto &feedbackProcessor : feedbackProcessors_)
         feedbackProcessor->SetColorValue(color);
 }
@@ -2464,10 +2823,24 @@ void Widget::RestoreXTouchDisplayColors()
 
 void  Widget::ForceClear()
 {
+    numFeedbackWrites_++;
+    
     for (auto &feedbackProcessor : feedbackProcessors_)
         feedbackProcessor->ForceClear();
 }
 
+void Widget::Clear()
+{
+    const PropertyList properties;
+    rgba_color color;
+    
+    UpdateValue(properties, 0.0);
+    UpdateValue(properties, "");
+    UpdateColorValue(color);
+    
+    isCleared_ = true;
+}
+
 void Widget::LogInput(double value)
 {
     if (g_surfaceInDisplay) LogToConsole(256, "IN <- %s %s %f\n", GetSurface()->GetName(), GetName(), value);
@@ -2525,7 +2898,7 @@ void OSC_FeedbackProcessor::SetColorValue(const rgba_color &color)
 
 void OSC_FeedbackProcessor::ForceValue(const PropertyList &properties, double value)
 {
-    if ((GetTickCount() - GetWidget()->GetLastIncomingMessageTime()) < 50) // adjust the 50 millisecond value to give you smooth behaviour without making updates sluggish
+    if ((g_clock.GetMilliseconds() - GetWidget()->GetLastIncomingMessageTime()) < 50) // adjust the 50 millisecond value to give you smooth behaviour without making updates sluggish
         return;
 
     lastDoubleValue_ = value;
@@ -2562,79 +2935,1515 @@ void OSC_IntFeedbackProcessor::ForceValue(const PropertyList &properties, double
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
-// ZoneManager
+// CSIZoneTemplateCache
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
-ZoneManager::ZoneManager(CSurfIntegrator *const csi, ControlSurface *surface, const string &zoneFolder, const string &fxZoneFolder) : csi_(csi), surface_(surface), zoneFolder_(zoneFolder), fxZoneFolder_(fxZoneFolder == "" ? zoneFolder : fxZoneFolder) {}
-
-Navigator *ZoneManager::GetNavigatorForTrack(MediaTrack *track) { return surface_->GetPage()->GetNavigatorForTrack(track); }
-Navigator *ZoneManager::GetMasterTrackNavigator() { return surface_->GetPage()->GetMasterTrackNavigator(); }
-Navigator *ZoneManager::GetSelectedTrackNavigator() { return surface_->GetPage()->GetSelectedTrackNavigator(); }
-Navigator *ZoneManager::GetFocusedFXNavigator() { return surface_->GetPage()->GetFocusedFXNavigator(); }
-int ZoneManager::GetNumChannels() { return surface_->GetNumChannels(); }
-
-void ZoneManager::Initialize()
+bool CSIZoneTemplateCache::IsCurrent(const string &filePath, filesystem::file_time_type &lastWriteTime, uintmax_t &fileSize)
 {
-    PreProcessZones();
+    error_code ec;
+    lastWriteTime = filesystem::last_write_time(filePath, ec);
+    fileSize = ec ? 0 : filesystem::file_size(filePath, ec);
+    
+    auto it = zoneTemplates_.find(filePath);
+    
+    return it != zoneTemplates_.end() && it->second->lastWriteTime == lastWriteTime && it->second->fileSize == fileSize;
+}
 
-    if (zoneInfo_.find("Home") == zoneInfo_.end())
+shared_ptr<CSIZoneTemplate> CSIZoneTemplateCache::GetZoneTemplate(const string &filePath)
+{
+    filesystem::file_time_type lastWriteTime;
+    uintmax_t fileSize = 0;
+    
+    if (IsCurrent(filePath, lastWriteTime, fileSize))
     {
-        char tmp[MEDBUF];
-        snprintf(tmp, sizeof(tmp), __LOCALIZE_VERFMT("%s needs a Home Zone to operate, please recheck your installation", "csi_mbox"), surface_->GetName());
-        MessageBox(g_hwnd, tmp, __LOCALIZE("CSI Missing Home Zone", "csi_mbox"), MB_OK);
-        return;
+        shared_ptr<CSIZoneTemplate> &zoneTemplate = zoneTemplates_[filePath];
+        numReused_++;
+        numHits_++;
+        zoneTemplate->lastUsed = ++useCounter_;
+        return zoneTemplate;
     }
-            
-    homeZone_ = make_unique<Zone>(csi_, this, GetSelectedTrackNavigator(), 0, "Home", "Home", zoneInfo_["Home"].filePath);
-    LoadZoneFile(homeZone_.get(), "");
     
-    vector<string> zoneList;
-    if (zoneInfo_.find("GoZones") != zoneInfo_.end())
-        LoadZoneMetadata(zoneInfo_["GoZones"].filePath.c_str(), zoneList);
-    LoadZones(goZones_, zoneList);
+    shared_ptr<CSIZoneTemplate> zoneTemplate = CompileZoneTemplate(filePath, lastWriteTime, fileSize);
+    zoneTemplate->lastUsed = ++useCounter_;
+    zoneTemplates_[filePath] = zoneTemplate;
+    numCompiled_++;
+    numMisses_++;
+    isDirty_ = true;
     
-    if (zoneInfo_.find("LastTouchedFXParam") != zoneInfo_.end())
+    EvictLeastRecentlyUsed();
+    
+    return zoneTemplate;
+}
+
+void CSIZoneTemplateCache::QueuePrefetch(const string &filePath)
+{
+    if (find(prefetchQueue_.begin(), prefetchQueue_.end(), filePath) == prefetchQueue_.end())
+        prefetchQueue_.push_back(filePath);
+}
+
+void CSIZoneTemplateCache::RunPrefetch(int maxFilesToCompile)
+{
+    int numCompiled = 0;
+    
+    while (prefetchQueue_.size() > 0 && numCompiled < maxFilesToCompile)
     {
-        lastTouchedFXParamZone_ = make_shared<Zone>(csi_, this, GetFocusedFXNavigator(), 0, "LastTouchedFXParam", "LastTouchedFXParam", zoneInfo_["LastTouchedFXParam"].filePath);
-        LoadZoneFile(lastTouchedFXParamZone_.get(), "");
-    }
+        string filePath = prefetchQueue_.front();
+        prefetchQueue_.erase(prefetchQueue_.begin());
         
-    homeZone_->Activate();
+        filesystem::file_time_type lastWriteTime;
+        uintmax_t fileSize = 0;
+        
+        if (IsCurrent(filePath, lastWriteTime, fileSize))
+            continue;
+        
+        shared_ptr<CSIZoneTemplate> zoneTemplate = CompileZoneTemplate(filePath, lastWriteTime, fileSize);
+        zoneTemplate->lastUsed = ++useCounter_;
+        zoneTemplates_[filePath] = zoneTemplate;
+        numPrefetched_++;
+        
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] RunPrefetch: %s, %d prefetched so far\n", GetRelativePath(filePath.c_str()), numPrefetched_);
+        numCompiled++;
+        isDirty_ = true;
+        
+        EvictLeastRecentlyUsed();
+    }
 }
 
-void ZoneManager::PreProcessZoneFile(const string &filePath)
+void CSIZoneTemplateCache::EvictLeastRecentlyUsed()
 {
-    try
+    while (zoneTemplates_.size() > s_capacity_)
     {
-        ifstream file(filePath);
+        auto leastRecentlyUsed = zoneTemplates_.begin();
         
-        CSIZoneInfo info;
-        info.filePath = filePath;
+        for (auto it = zoneTemplates_.begin(); it != zoneTemplates_.end(); ++it)
+            if (it->second->lastUsed < leastRecentlyUsed->second->lastUsed)
+                leastRecentlyUsed = it;
         
-        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] PreProcessZoneFile: %s\n", GetRelativePath(filePath.c_str()));
-        for (string line; getline(file, line) ; )
-        {
-            TrimLine(line);
-            
-            if (line == "" || (line.size() > 0 && line[0] == '/')) // ignore blank lines and comment lines
-                continue;
-            
-            vector<string> tokens;
-            GetTokens(tokens, line);
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] EvictLeastRecentlyUsed: %s\n", GetRelativePath(leastRecentlyUsed->first.c_str()));
+        
+        zoneTemplates_.erase(leastRecentlyUsed);
+    }
+}
 
-            if (tokens[0] == "Zone" && tokens.size() > 1)
-            {
-                info.alias = tokens.size() > 2 ? tokens[2] : tokens[1];
-                AddZoneFilePath(tokens[1], info);
-            }
+static const char s_ZoneTemplateCacheMagic[] = "CSIZT";
+static const int s_ZoneTemplateCacheVersion = 1;
 
-            break;
-        }
+static void WriteCacheInt(FILE *file, long long value) { fwrite(&value, sizeof(value), 1, file); }
+
+static void WriteCacheString(FILE *file, const string &value)
+{
+    WriteCacheInt(file, (long long)value.size());
+    fwrite(value.data(), 1, value.size(), file);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CacheFileReader
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    const vector<char> &buffer_;
+    size_t position_ = 0;
+    bool isValid_ = true;
+    
+public:
+    CacheFileReader(const vector<char> &buffer) : buffer_(buffer) {}
+    
+    bool IsValid() { return isValid_; }
+    
+    long long ReadInt()
+    {
+        long long value = 0;
+        
+        if ( ! isValid_ || position_ + sizeof(value) > buffer_.size())
+        {
+            isValid_ = false;
+            return 0;
+        }
+        
+        memcpy(&value, &buffer_[position_], sizeof(value));
+        position_ += sizeof(value);
+        
+        return value;
+    }
+    
+    void ReadString(string &value)
+    {
+        long long size = ReadInt();
+        
+        if ( ! isValid_ || size < 0 || position_ + size > buffer_.size())
+        {
+            isValid_ = false;
+            return;
+        }
+        
+        value.assign(&buffer_[0] + position_, (size_t)size);
+        position_ += (size_t)size;
+    }
+    
+    void ReadBytes(void *value, size_t size)
+    {
+        if ( ! isValid_ || position_ + size > buffer_.size())
+        {
+            isValid_ = false;
+            return;
+        }
+        
+        if (size > 0)
+            memcpy(value, &buffer_[position_], size);
+        position_ += size;
+    }
+    
+    bool IsAtEnd() { return position_ >= buffer_.size(); }
+};
+
+static void ReadCacheFile(const string &cacheFilePath, vector<char> &buffer)
+{
+    if (FILE *file = fopenUTF8(cacheFilePath.c_str(), "rb"))
+    {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        
+        if (size > 0)
+        {
+            buffer.resize(size);
+            
+            if (fread(&buffer[0], 1, size, file) != size)
+                buffer.clear();
+        }
+        
+        fclose(file);
+    }
+}
+
+void CSIZoneTemplateCache::LoadFromFile(const string &cacheFilePath)
+{
+    vector<char> buffer;
+    ReadCacheFile(cacheFilePath, buffer);
+    
+    if (buffer.size() == 0)
+        return;
+    
+    CacheFileReader reader(buffer);
+    
+    string magic;
+    reader.ReadString(magic);
+    
+    if (magic != s_ZoneTemplateCacheMagic || reader.ReadInt() != s_ZoneTemplateCacheVersion)
+    {
+        if (g_debugLevel >= DEBUG_LEVEL_NOTICE) LogToConsole(256, "[NOTICE] Ignoring zone template cache %s, wrong version\n", GetRelativePath(cacheFilePath.c_str()));
+        return;
+    }
+    
+    map<const string, shared_ptr<CSIZoneTemplate>> zoneTemplates;
+    
+    long long numTemplates = reader.ReadInt();
+    
+    for (long long i = 0; i < numTemplates && reader.IsValid(); ++i)
+    {
+        shared_ptr<CSIZoneTemplate> zoneTemplate = make_shared<CSIZoneTemplate>();
+        
+        reader.ReadString(zoneTemplate->filePath);
+        zoneTemplate->lastWriteTime = filesystem::file_time_type(filesystem::file_time_type::duration(reader.ReadInt()));
+        zoneTemplate->fileSize = (uintmax_t)reader.ReadInt();
+        
+        long long numLines = reader.ReadInt();
+        
+        for (long long j = 0; j < numLines && reader.IsValid(); ++j)
+        {
+            zoneTemplate->lines.push_back(CSIZoneTemplateLine());
+            CSIZoneTemplateLine &templateLine = zoneTemplate->lines.back();
+            
+            templateLine.lineNumber = (int)reader.ReadInt();
+            
+            long long flags = reader.ReadInt();
+            templateLine.hasWidgetSuffix = (flags & 0x01) != 0;
+            templateLine.hasWidgetNameAndModifiers = (flags & 0x02) != 0;
+            templateLine.isValueInverted = (flags & 0x04) != 0;
+            templateLine.isFeedbackInverted = (flags & 0x08) != 0;
+            templateLine.hasHoldModifier = (flags & 0x10) != 0;
+            templateLine.hasDoublePressPseudoModifier = (flags & 0x20) != 0;
+            templateLine.isDecrease = (flags & 0x40) != 0;
+            templateLine.isIncrease = (flags & 0x80) != 0;
+            
+            reader.ReadString(templateLine.line);
+            
+            long long numTokens = reader.ReadInt();
+            
+            for (long long k = 0; k < numTokens && reader.IsValid(); ++k)
+            {
+                templateLine.tokens.push_back(string());
+                reader.ReadString(templateLine.tokens.back());
+            }
+            
+            reader.ReadString(templateLine.baseWidgetName);
+            templateLine.modifier = (int)reader.ReadInt();
+        }
+        
+        zoneTemplates[zoneTemplate->filePath] = zoneTemplate;
+    }
+    
+    if ( ! reader.IsValid())
+    {
+        LogToConsole(256, "[ERROR] FAILED to LoadFromFile, zone template cache %s is damaged and will be rebuilt\n", GetRelativePath(cacheFilePath.c_str()));
+        return;
+    }
+    
+    zoneTemplates_ = zoneTemplates;
+    isDirty_ = false;
+    
+    EvictLeastRecentlyUsed();
+    
+    if (g_debugLevel >= DEBUG_LEVEL_INFO) LogToConsole(256, "[INFO] Loaded %d zone templates from %s\n", (int)zoneTemplates_.size(), GetRelativePath(cacheFilePath.c_str()));
+}
+
+void CSIZoneTemplateCache::SaveToFile(const string &cacheFilePath)
+{
+    if ( ! isDirty_)
+        return;
+    
+    try
+    {
+        RecursiveCreateDirectory(filesystem::path(cacheFilePath).parent_path().string().c_str(), 0);
+        
+        // write to a temporary file first so a crash mid-write never leaves a damaged cache behind
+        string tmpFilePath = cacheFilePath + ".tmp";
+        
+        FILE *file = fopenUTF8(tmpFilePath.c_str(), "wb");
+        
+        if ( ! file)
+        {
+            LogToConsole(256, "[ERROR] FAILED to SaveToFile, cannot open %s\n", tmpFilePath.c_str());
+            return;
+        }
+        
+        WriteCacheString(file, s_ZoneTemplateCacheMagic);
+        WriteCacheInt(file, s_ZoneTemplateCacheVersion);
+        
+        vector<CSIZoneTemplate *> zoneTemplates;
+        
+        for (auto &entry : zoneTemplates_)
+        {
+            error_code ec;
+            if (filesystem::exists(entry.first, ec)) // zone files that were removed are dropped from the cache
+                zoneTemplates.push_back(entry.second.get());
+        }
+        
+        WriteCacheInt(file, (long long)zoneTemplates.size());
+        
+        for (CSIZoneTemplate *entry : zoneTemplates)
+        {
+            const CSIZoneTemplate &zoneTemplate = *entry;
+            
+            WriteCacheString(file, zoneTemplate.filePath);
+            WriteCacheInt(file, (long long)zoneTemplate.lastWriteTime.time_since_epoch().count());
+            WriteCacheInt(file, (long long)zoneTemplate.fileSize);
+            WriteCacheInt(file, (long long)zoneTemplate.lines.size());
+            
+            for (const CSIZoneTemplateLine &templateLine : zoneTemplate.lines)
+            {
+                WriteCacheInt(file, templateLine.lineNumber);
+                
+                long long flags = (templateLine.hasWidgetSuffix ? 0x01 : 0) |
+                                  (templateLine.hasWidgetNameAndModifiers ? 0x02 : 0) |
+                                  (templateLine.isValueInverted ? 0x04 : 0) |
+                                  (templateLine.isFeedbackInverted ? 0x08 : 0) |
+                                  (templateLine.hasHoldModifier ? 0x10 : 0) |
+                                  (templateLine.hasDoublePressPseudoModifier ? 0x20 : 0) |
+                                  (templateLine.isDecrease ? 0x40 : 0) |
+                                  (templateLine.isIncrease ? 0x80 : 0);
+                WriteCacheInt(file, flags);
+                
+                WriteCacheString(file, templateLine.line);
+                
+                WriteCacheInt(file, (long long)templateLine.tokens.size());
+                
+                for (const string &token : templateLine.tokens)
+                    WriteCacheString(file, token);
+                
+                WriteCacheString(file, templateLine.baseWidgetName);
+                WriteCacheInt(file, templateLine.modifier);
+            }
+        }
+        
+        bool isWritten = ferror(file) == 0;
+        fclose(file);
+        
+        if (isWritten)
+        {
+            error_code ec;
+            filesystem::rename(tmpFilePath, cacheFilePath, ec);
+            
+            if (ec)
+                LogToConsole(256, "[ERROR] FAILED to SaveToFile, cannot replace %s\n", cacheFilePath.c_str());
+            else
+                isDirty_ = false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogToConsole(256, "[ERROR] FAILED to SaveToFile %s\n", cacheFilePath.c_str());
+        LogToConsole(2048, "Exception: %s\n", e.what());
+    }
+}
+
+shared_ptr<CSIZoneTemplate> CSIZoneTemplateCache::CompileZoneTemplate(const string &filePath, filesystem::file_time_type lastWriteTime, uintmax_t fileSize)
+{
+    shared_ptr<CSIZoneTemplate> zoneTemplate = make_shared<CSIZoneTemplate>();
+    zoneTemplate->filePath = filePath;
+    zoneTemplate->lastWriteTime = lastWriteTime;
+    zoneTemplate->fileSize = fileSize;
+    
+    int lineNumber = 0;
+    
+    try
+    {
+        ifstream file(filePath);
+        
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] CompileZoneTemplate: %s\n", GetRelativePath(filePath.c_str()));
+        for (string line; getline(file, line) ; )
+        {
+            TrimLine(line);
+            
+            lineNumber++;
+            
+            if (line == "" || (line.size() > 0 && line[0] == '/')) // ignore blank lines and comment lines
+                continue;
+            
+            if (line == s_BeginAutoSection || line == s_EndAutoSection)
+                continue;
+            
+            zoneTemplate->lines.push_back(CSIZoneTemplateLine());
+            CSIZoneTemplateLine &templateLine = zoneTemplate->lines.back();
+            
+            templateLine.lineNumber = lineNumber;
+            templateLine.hasWidgetSuffix = line.find('|') != string::npos;
+            
+            if (templateLine.hasWidgetSuffix)
+                templateLine.line = line;
+            
+            GetTokens(templateLine.tokens, line);
+            
+            if (templateLine.tokens.size() > 1)
+            {
+                // the modifiers can be parsed up front as long as the | placeholder is only part of the base widget name
+                const string &widgetToken = templateLine.tokens[0];
+                size_t lastPlus = widgetToken.rfind('+');
+                size_t baseWidgetNameStart = lastPlus == string::npos ? 0 : lastPlus + 1;
+                size_t firstSuffix = widgetToken.find('|');
+                
+                if (firstSuffix == string::npos || (firstSuffix >= baseWidgetNameStart && widgetToken.find_first_not_of('|', baseWidgetNameStart) != string::npos))
+                {
+                    templateLine.hasWidgetNameAndModifiers = true;
+                    
+                    ZoneManager::GetWidgetNameAndModifiers(widgetToken, templateLine.baseWidgetName, templateLine.modifier, templateLine.isValueInverted, templateLine.isFeedbackInverted, templateLine.hasHoldModifier, templateLine.hasDoublePressPseudoModifier, templateLine.isDecrease, templateLine.isIncrease);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogToConsole(256, "[ERROR] FAILED to CompileZoneTemplate in %s, around line %d\n", filePath.c_str(), lineNumber);
+        LogToConsole(2048, "Exception: %s\n", e.what());
+    }
+    
+    return zoneTemplate;
+}
+
+void CSIZoneTemplateCache::AddToMemoryReport(CSIMemoryReport &report)
+{
+    size_t templateBytes = 0;
+    int numLines = 0;
+    size_t lineBytes = 0;
+    
+    for (auto &entry : zoneTemplates_)
+    {
+        const CSIZoneTemplate &zoneTemplate = *entry.second;
+        
+        templateBytes += s_mapNodeOverhead + sizeof(entry) + CSIMemoryReport::GetStringBytes(entry.first) + sizeof(CSIZoneTemplate) + CSIMemoryReport::GetStringBytes(zoneTemplate.filePath);
+        
+        numLines += (int)zoneTemplate.lines.size();
+        lineBytes += zoneTemplate.lines.capacity() * sizeof(CSIZoneTemplateLine);
+        
+        for (auto &line : zoneTemplate.lines)
+        {
+            lineBytes += CSIMemoryReport::GetStringBytes(line.line) + CSIMemoryReport::GetStringBytes(line.baseWidgetName) + line.tokens.capacity() * sizeof(string);
+            
+            for (auto &token : line.tokens)
+                lineBytes += CSIMemoryReport::GetStringBytes(token);
+        }
+    }
+    
+    for (auto &filePath : prefetchQueue_)
+        templateBytes += sizeof(string) + CSIMemoryReport::GetStringBytes(filePath);
+    
+    report.Add("ZoneTemplate", (int)zoneTemplates_.size(), templateBytes);
+    report.Add("ZoneTemplateLine", numLines, lineBytes);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSIZoneManifest
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CSIZoneManifest::ReadZoneHeader(CSIZoneManifestEntry &entry)
+{
+    entry.name = "";
+    entry.alias = "";
+    
+    try
+    {
+        ifstream file(entry.filePath);
+        
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] ReadZoneHeader: %s\n", GetRelativePath(entry.filePath.c_str()));
+        for (string line; getline(file, line) ; )
+        {
+            TrimLine(line);
+            
+            if (line == "" || (line.size() > 0 && line[0] == '/')) // ignore blank lines and comment lines
+                continue;
+            
+            vector<string> tokens;
+            GetTokens(tokens, line);
+
+            if (tokens.size() > 1 && tokens[0] == "Zone")
+            {
+                entry.name = tokens[1];
+                entry.alias = tokens.size() > 2 ? tokens[2] : tokens[1];
+            }
+
+            break;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogToConsole(256, "[ERROR] FAILED to ReadZoneHeader in %s\n", entry.filePath.c_str());
+        LogToConsole(2048, "Exception: %s\n", e.what());
+    }
+}
+
+bool CSIZoneManifest::Update(int &numFilesRead, int &numFilesReused)
+{
+    needsUpdate_ = false;
+    
+    map<const string, CSIZoneManifestEntry> previousEntries;
+    
+    for (auto &entry : entries_)
+        previousEntries[entry.filePath] = entry;
+    
+    size_t numPreviousEntries = entries_.size();
+    entries_.clear();
+    
+    bool hasChanged = false;
+    
+    try
+    {
+        string path = folder_ + "/";
+        
+        if (filesystem::exists(path) && filesystem::is_directory(path))
+        {
+            for (auto &file : filesystem::recursive_directory_iterator(path)) // recursively find all .zon files, starting at folder
+            {
+                if (file.path().extension() != ".zon")
+                    continue;
+                
+                CSIZoneManifestEntry entry;
+                entry.filePath = file.path().string();
+                
+                error_code ec;
+                entry.lastWriteTime = file.last_write_time(ec);
+                entry.fileSize = ec ? 0 : file.file_size(ec);
+                
+                auto previous = previousEntries.find(entry.filePath);
+                
+                if (previous != previousEntries.end() && previous->second.lastWriteTime == entry.lastWriteTime && previous->second.fileSize == entry.fileSize)
+                {
+                    entry.name = previous->second.name;
+                    entry.alias = previous->second.alias;
+                    numFilesReused++;
+                }
+                else
+                {
+                    ReadZoneHeader(entry);
+                    numFilesRead++;
+                    hasChanged = true;
+                }
+                
+                entries_.push_back(entry);
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogToConsole(256, "[ERROR] FAILED to Update zone manifest for %s\n", folder_.c_str());
+        LogToConsole(2048, "Exception: %s\n", e.what());
+    }
+    
+    return hasChanged || entries_.size() != numPreviousEntries;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSIZoneManifestCache
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const char s_ZoneManifestCacheMagic[] = "CSIZM";
+static const int s_ZoneManifestCacheVersion = 1;
+
+CSIZoneManifest &CSIZoneManifestCache::GetZoneManifest(const string &folder)
+{
+    auto it = zoneManifests_.find(folder);
+    
+    if (it == zoneManifests_.end())
+        it = zoneManifests_.insert(make_pair(folder, make_unique<CSIZoneManifest>(folder))).first;
+    
+    CSIZoneManifest &zoneManifest = *it->second;
+    
+    if (zoneManifest.GetNeedsUpdate() && zoneManifest.Update(numFilesRead_, numFilesReused_))
+        isDirty_ = true;
+    
+    return zoneManifest;
+}
+
+void CSIZoneManifestCache::AddToMemoryReport(CSIMemoryReport &report)
+{
+    size_t manifestBytes = 0;
+    int numEntries = 0;
+    size_t entryBytes = 0;
+    
+    for (auto &entry : zoneManifests_)
+    {
+        CSIZoneManifest &zoneManifest = *entry.second;
+        
+        manifestBytes += s_mapNodeOverhead + sizeof(entry) + CSIMemoryReport::GetStringBytes(entry.first) + sizeof(CSIZoneManifest) + CSIMemoryReport::GetStringBytes(zoneManifest.GetFolder());
+        
+        numEntries += (int)zoneManifest.GetEntries().size();
+        entryBytes += zoneManifest.GetEntries().capacity() * sizeof(CSIZoneManifestEntry);
+        
+        for (auto &manifestEntry : zoneManifest.GetEntries())
+            entryBytes += CSIMemoryReport::GetStringBytes(manifestEntry.filePath) + CSIMemoryReport::GetStringBytes(manifestEntry.name) + CSIMemoryReport::GetStringBytes(manifestEntry.alias);
+    }
+    
+    report.Add("ZoneManifest", (int)zoneManifests_.size(), manifestBytes);
+    report.Add("ZoneManifestEntry", numEntries, entryBytes);
+}
+
+void CSIZoneManifestCache::LoadFromFile(const string &cacheFilePath)
+{
+    vector<char> buffer;
+    ReadCacheFile(cacheFilePath, buffer);
+    
+    if (buffer.size() == 0)
+        return;
+    
+    CacheFileReader reader(buffer);
+    
+    string magic;
+    reader.ReadString(magic);
+    
+    if (magic != s_ZoneManifestCacheMagic || reader.ReadInt() != s_ZoneManifestCacheVersion)
+    {
+        if (g_debugLevel >= DEBUG_LEVEL_NOTICE) LogToConsole(256, "[NOTICE] Ignoring zone manifest cache %s, wrong version\n", GetRelativePath(cacheFilePath.c_str()));
+        return;
+    }
+    
+    map<const string, unique_ptr<CSIZoneManifest>> zoneManifests;
+    
+    long long numManifests = reader.ReadInt();
+    
+    for (long long i = 0; i < numManifests && reader.IsValid(); ++i)
+    {
+        string folder;
+        reader.ReadString(folder);
+        
+        unique_ptr<CSIZoneManifest> zoneManifest = make_unique<CSIZoneManifest>(folder);
+        
+        long long numEntries = reader.ReadInt();
+        
+        for (long long j = 0; j < numEntries && reader.IsValid(); ++j)
+        {
+            CSIZoneManifestEntry entry;
+            reader.ReadString(entry.filePath);
+            entry.lastWriteTime = filesystem::file_time_type(filesystem::file_time_type::duration(reader.ReadInt()));
+            entry.fileSize = (uintmax_t)reader.ReadInt();
+            reader.ReadString(entry.name);
+            reader.ReadString(entry.alias);
+            
+            zoneManifest->GetEntries().push_back(entry);
+        }
+        
+        zoneManifests[folder] = move(zoneManifest);
+    }
+    
+    if ( ! reader.IsValid())
+    {
+        LogToConsole(256, "[ERROR] FAILED to LoadFromFile, zone manifest cache %s is damaged and will be rebuilt\n", GetRelativePath(cacheFilePath.c_str()));
+        return;
+    }
+    
+    zoneManifests_ = move(zoneManifests);
+    isDirty_ = false;
+}
+
+void CSIZoneManifestCache::SaveToFile(const string &cacheFilePath)
+{
+    if ( ! isDirty_)
+        return;
+    
+    try
+    {
+        RecursiveCreateDirectory(filesystem::path(cacheFilePath).parent_path().string().c_str(), 0);
+        
+        string tmpFilePath = cacheFilePath + ".tmp";
+        
+        FILE *file = fopenUTF8(tmpFilePath.c_str(), "wb");
+        
+        if ( ! file)
+        {
+            LogToConsole(256, "[ERROR] FAILED to SaveToFile, cannot open %s\n", tmpFilePath.c_str());
+            return;
+        }
+        
+        WriteCacheString(file, s_ZoneManifestCacheMagic);
+        WriteCacheInt(file, s_ZoneManifestCacheVersion);
+        WriteCacheInt(file, (long long)zoneManifests_.size());
+        
+        for (auto &zoneManifest : zoneManifests_)
+        {
+            WriteCacheString(file, zoneManifest.second->GetFolder());
+            WriteCacheInt(file, (long long)zoneManifest.second->GetEntries().size());
+            
+            for (const CSIZoneManifestEntry &entry : zoneManifest.second->GetEntries())
+            {
+                WriteCacheString(file, entry.filePath);
+                WriteCacheInt(file, (long long)entry.lastWriteTime.time_since_epoch().count());
+                WriteCacheInt(file, (long long)entry.fileSize);
+                WriteCacheString(file, entry.name);
+                WriteCacheString(file, entry.alias);
+            }
+        }
+        
+        bool isWritten = ferror(file) == 0;
+        fclose(file);
+        
+        if (isWritten)
+        {
+            error_code ec;
+            filesystem::rename(tmpFilePath, cacheFilePath, ec);
+            
+            if (ec)
+                LogToConsole(256, "[ERROR] FAILED to SaveToFile, cannot replace %s\n", cacheFilePath.c_str());
+            else
+                isDirty_ = false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogToConsole(256, "[ERROR] FAILED to SaveToFile %s\n", cacheFilePath.c_str());
+        LogToConsole(2048, "Exception: %s\n", e.what());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSIFXParamValueCache
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const int s_fxParamsRefreshedPerRun = 8;
+static const int s_fxParamUnusedTicks = 300; // entries nobody has read for this many Run ticks are dropped
+
+CSIFXParamValue &CSIFXParamValueCache::GetEntry(MediaTrack *track, int fxSlot, int paramIndex)
+{
+    CSIFXParamKey key;
+    key.track = track;
+    key.fxSlot = fxSlot;
+    key.paramIndex = paramIndex;
+    
+    CSIFXParamValue &fxParamValue = fxParamValues_[key];
+    
+    fxParamValue.lastReadTick = tick_;
+    
+    return fxParamValue;
+}
+
+double CSIFXParamValueCache::GetParamNormalized(CSIFXParamValue &fxParamValue, MediaTrack *track, int fxSlot, int paramIndex)
+{
+    if (! fxParamValue.isValid)
+    {
+        const double value = TrackFX_GetParamNormalized(track, fxSlot, paramIndex);
+        
+        // notifications and the background refresh only invalidate, feedback moves on when the value really changed
+        if (fxParamValue.changeSerial == 0 || value != fxParamValue.value)
+            fxParamValue.changeSerial = ++changeSerial_;
+        
+        fxParamValue.value = value;
+        fxParamValue.isValid = true;
+    }
+    
+    return fxParamValue.value;
+}
+
+double CSIFXParamValueCache::GetParamNormalized(MediaTrack *track, int fxSlot, int paramIndex)
+{
+    return GetParamNormalized(GetEntry(track, fxSlot, paramIndex), track, fxSlot, paramIndex);
+}
+
+int CSIFXParamValueCache::GetChangeSerial(MediaTrack *track, int fxSlot, int paramIndex)
+{
+    CSIFXParamValue &fxParamValue = GetEntry(track, fxSlot, paramIndex);
+    
+    GetParamNormalized(fxParamValue, track, fxSlot, paramIndex);
+    
+    return fxParamValue.changeSerial;
+}
+
+const char *CSIFXParamValueCache::GetFormattedParamValue(MediaTrack *track, int fxSlot, int paramIndex)
+{
+    CSIFXParamValue &fxParamValue = GetEntry(track, fxSlot, paramIndex);
+    
+    double value = GetParamNormalized(fxParamValue, track, fxSlot, paramIndex);
+    
+    if (fxParamValue.isFormattedValueValid && fxParamValue.formattedValueSource == value)
+    {
+        numDisplayHits_++;
+        return fxParamValue.formattedValue.c_str();
+    }
+    
+    numDisplayMisses_++;
+    
+    char formattedValue[128];
+    formattedValue[0] = 0;
+    TrackFX_GetFormattedParamValue(track, fxSlot, paramIndex, formattedValue, sizeof(formattedValue));
+    
+    fxParamValue.formattedValue = formattedValue;
+    fxParamValue.formattedValueSource = value;
+    fxParamValue.isFormattedValueValid = true;
+    
+    return fxParamValue.formattedValue.c_str();
+}
+
+const char *CSIFXParamValueCache::GetParamName(MediaTrack *track, int fxSlot, int paramIndex)
+{
+    CSIFXParamValue &fxParamValue = GetEntry(track, fxSlot, paramIndex);
+    
+    if (fxParamValue.isNameValid)
+    {
+        numDisplayHits_++;
+        return fxParamValue.name.c_str();
+    }
+    
+    numDisplayMisses_++;
+    
+    char name[MEDBUF];
+    name[0] = 0;
+    TrackFX_GetParamName(track, fxSlot, paramIndex, name, sizeof(name));
+    
+    fxParamValue.name = name;
+    fxParamValue.isNameValid = true;
+    
+    return fxParamValue.name.c_str();
+}
+
+void CSIFXParamValueCache::OnParamChange(MediaTrack *track, int fxSlot, int paramIndex)
+{
+    CSIFXParamKey key;
+    key.track = track;
+    key.fxSlot = fxSlot;
+    key.paramIndex = paramIndex;
+    
+    // only params somebody reads are cached, the value is re-read on the next Get
+    auto it = fxParamValues_.find(key);
+    
+    if (it != fxParamValues_.end())
+        it->second.isValid = false;
+}
+
+void CSIFXParamValueCache::InvalidateTrack(MediaTrack *track)
+{
+    CSIFXParamKey key;
+    key.track = track;
+    key.fxSlot = -1;
+    key.paramIndex = -1;
+    
+    auto it = fxParamValues_.lower_bound(key);
+    
+    while (it != fxParamValues_.end() && it->first.track == track)
+        it = fxParamValues_.erase(it);
+}
+
+void CSIFXParamValueCache::AddToMemoryReport(CSIMemoryReport &report)
+{
+    size_t bytes = 0;
+    
+    for (auto &entry : fxParamValues_)
+        bytes += s_mapNodeOverhead + sizeof(entry) + CSIMemoryReport::GetStringBytes(entry.second.formattedValue) + CSIMemoryReport::GetStringBytes(entry.second.name);
+    
+    report.Add("FXParamValue", (int)fxParamValues_.size(), bytes);
+}
+
+void CSIFXParamValueCache::Run()
+{
+    tick_++;
+    
+    if (tick_ % s_fxParamUnusedTicks == 0 && numDisplayHits_ + numDisplayMisses_ > 0)
+    {
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] CSIFXParamValueCache: %d params, display strings %d hits %d misses (%.1f%% hit rate)\n", GetNumParams(), numDisplayHits_, numDisplayMisses_, GetDisplayHitRate());
+        
+        numDisplayHits_ = 0;
+        numDisplayMisses_ = 0;
+    }
+    
+    auto it = fxParamValues_.upper_bound(refreshCursor_);
+    
+    for (int i = 0; i < s_fxParamsRefreshedPerRun && fxParamValues_.size() > 0; ++i)
+    {
+        if (it == fxParamValues_.end())
+            it = fxParamValues_.begin();
+        
+        if (tick_ - it->second.lastReadTick > s_fxParamUnusedTicks)
+        {
+            it = fxParamValues_.erase(it);
+            continue;
+        }
+        
+        // plugins may also reformat or rename params without the value changing
+        it->second.isValid = false;
+        it->second.isFormattedValueValid = false;
+        it->second.isNameValid = false;
+        refreshCursor_ = it->first;
+        ++it;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSISessionCapture
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static const char s_SessionCaptureMagic[] = "CSICAP";
+static const int s_SessionCaptureVersion = 1;
+static const int s_replayFinishTicks = 30; // Run ticks to let the last feedback go out after the final input
+
+bool CSISessionCapture::StartRecording(const string &filePath)
+{
+    if (recordFile_ != NULL || isReplaying_)
+        return false;
+    
+    recordFile_ = fopenUTF8(filePath.c_str(), "wb");
+    
+    if (recordFile_ == NULL)
+    {
+        LogToConsole(256, "[ERROR] FAILED to StartRecording, cannot open %s\n", filePath.c_str());
+        return false;
+    }
+    
+    WriteCacheString(recordFile_, s_SessionCaptureMagic);
+    WriteCacheInt(recordFile_, s_SessionCaptureVersion);
+    
+    recordFilePath_ = filePath;
+    recordStartTime_ = g_clock.GetMilliseconds();
+    recordIONames_.clear();
+    g_isSessionCaptureActive = true;
+    
+    LogToConsole(MEDBUF, "[INFO] Recording surface session to %s\n", filePath.c_str());
+    
+    return true;
+}
+
+void CSISessionCapture::StopRecording()
+{
+    if (recordFile_ == NULL)
+        return;
+    
+    fclose(recordFile_);
+    recordFile_ = NULL;
+    g_isSessionCaptureActive = isReplaying_;
+    
+    LogToConsole(MEDBUF, "[INFO] Surface session recorded to %s, %d ms\n", recordFilePath_.c_str(), (int)(g_clock.GetMilliseconds() - recordStartTime_));
+}
+
+void CSISessionCapture::WriteEvent(unsigned char type, const char *ioName, const void *data, int size)
+{
+    int ioIndex = -1;
+    
+    for (int i = 0; i < recordIONames_.size(); ++i)
+        if (recordIONames_[i] == ioName)
+            ioIndex = i;
+    
+    if (ioIndex < 0)
+    {
+        if (recordIONames_.size() > 255)
+            return;
+        
+        // the name is written once, every event after that refers to its index
+        ioIndex = (int)recordIONames_.size();
+        recordIONames_.push_back(ioName);
+        
+        const unsigned char header[2] = { CaptureIOName, (unsigned char)ioIndex };
+        fwrite(header, 1, sizeof(header), recordFile_);
+        WriteCacheString(recordFile_, ioName);
+    }
+    
+    // [type][io index][time ms][size][data]
+    const unsigned char header[2] = { type, (unsigned char)ioIndex };
+    const unsigned int time = (unsigned int)(g_clock.GetMilliseconds() - recordStartTime_);
+    const unsigned int dataSize = (unsigned int)size;
+    
+    fwrite(header, 1, sizeof(header), recordFile_);
+    fwrite(&time, sizeof(time), 1, recordFile_);
+    fwrite(&dataSize, sizeof(dataSize), 1, recordFile_);
+    fwrite(data, 1, size, recordFile_);
+}
+
+bool CSISessionCapture::LoadReplay(const string &filePath)
+{
+    replayEvents_.clear();
+    replayIONames_.clear();
+    
+    vector<char> buffer;
+    ReadCacheFile(filePath, buffer);
+    
+    CacheFileReader reader(buffer);
+    
+    string magic;
+    reader.ReadString(magic);
+    
+    if (magic != s_SessionCaptureMagic || reader.ReadInt() != s_SessionCaptureVersion)
+        return false;
+    
+    while (reader.IsValid() && ! reader.IsAtEnd())
+    {
+        unsigned char header[2] = { 0, 0 };
+        reader.ReadBytes(header, sizeof(header));
+        
+        if (header[0] == CaptureIOName)
+        {
+            string ioName;
+            reader.ReadString(ioName);
+            
+            if (header[1] != replayIONames_.size())
+                return false;
+            
+            replayIONames_.push_back(ioName);
+            continue;
+        }
+        
+        unsigned int time = 0;
+        unsigned int dataSize = 0;
+        reader.ReadBytes(&time, sizeof(time));
+        reader.ReadBytes(&dataSize, sizeof(dataSize));
+        
+        if ( ! reader.IsValid() || header[1] >= replayIONames_.size() || dataSize > buffer.size())
+            return false;
+        
+        CSICaptureEvent event;
+        event.type = header[0];
+        event.ioIndex = header[1];
+        event.time = time;
+        event.data.resize(dataSize);
+        reader.ReadBytes(event.data.data(), dataSize);
+        
+        replayEvents_.push_back(event);
+    }
+    
+    return reader.IsValid();
+}
+
+bool CSISessionCapture::StartReplay(const string &filePath, bool asFastAsPossible)
+{
+    if (recordFile_ != NULL || isReplaying_)
+        return false;
+    
+    try
+    {
+        if ( ! LoadReplay(filePath))
+        {
+            LogToConsole(256, "[ERROR] FAILED to StartReplay, %s is not a valid session capture\n", filePath.c_str());
+            replayEvents_.clear();
+            return false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogToConsole(256, "[ERROR] FAILED to StartReplay: %s\n", e.what());
+        replayEvents_.clear();
+        return false;
+    }
+    
+    replayCursors_.assign(replayIONames_.size(), 0);
+    replayOutput_.clear();
+    replayStartTime_ = g_clock.GetMilliseconds();
+    replayTime_ = 0;
+    replayFinishTicks_ = s_replayFinishTicks;
+    isReplayStopRequested_ = false;
+    isReplayAsFastAsPossible_ = asFastAsPossible;
+    isReplaying_ = true;
+    g_isSessionCaptureActive = true;
+    
+    LogToConsole(MEDBUF, "[INFO] Replaying surface session %s, %d events%s\n", filePath.c_str(), (int)replayEvents_.size(), asFastAsPossible ? ", as fast as possible" : "");
+    LogToConsole(MEDBUF, "[INFO] Live input on the replayed surfaces is ignored, stop with ReplaySession on another surface or Control surface: Refresh all surfaces\n");
+    
+    return true;
+}
+
+void CSISessionCapture::StopReplay()
+{
+    // finished by the next Run, an action may stop the replay while one of its packets is still being processed
+    if (isReplaying_)
+        isReplayStopRequested_ = true;
+}
+
+int CSISessionCapture::GetReplayIOIndex(const char *ioName)
+{
+    for (int i = 0; i < replayIONames_.size(); ++i)
+        if (replayIONames_[i] == ioName)
+            return i;
+    
+    return -1;
+}
+
+const CSICaptureEvent *CSISessionCapture::PeekReplayInput(int ioIndex)
+{
+    size_t &cursor = replayCursors_[ioIndex];
+    
+    while (cursor < replayEvents_.size() && (replayEvents_[cursor].ioIndex != ioIndex || ! GetIsInput(replayEvents_[cursor].type)))
+        cursor++;
+    
+    return cursor < replayEvents_.size() ? &replayEvents_[cursor] : NULL;
+}
+
+const CSICaptureEvent *CSISessionCapture::GetNextReplayInput(const char *ioName)
+{
+    int ioIndex = GetReplayIOIndex(ioName);
+    
+    if (ioIndex < 0 || isReplayStopRequested_)
+        return NULL;
+    
+    const CSICaptureEvent *event = PeekReplayInput(ioIndex);
+    
+    if (event == NULL || event->time > replayTime_)
+        return NULL;
+    
+    replayCursors_[ioIndex]++;
+    
+    return event;
+}
+
+void CSISessionCapture::Run()
+{
+    if ( ! isReplaying_)
+        return;
+    
+    if (isReplayStopRequested_)
+    {
+        FinishReplay();
+        return;
+    }
+    
+    const CSICaptureEvent *nextInput = NULL;
+    
+    for (int i = 0; i < replayIONames_.size(); ++i)
+    {
+        const CSICaptureEvent *event = PeekReplayInput(i);
+        
+        if (event != NULL && (nextInput == NULL || event->time < nextInput->time))
+            nextInput = event;
+    }
+    
+    if (nextInput == NULL)
+    {
+        if (--replayFinishTicks_ <= 0)
+            FinishReplay();
+        return;
+    }
+    
+    // as fast as possible skips the idle time between inputs, so every Run gets the next batch
+    if (isReplayAsFastAsPossible_)
+        replayTime_ = max(replayTime_, nextInput->time);
+    else
+        replayTime_ = g_clock.GetMilliseconds() - replayStartTime_;
+}
+
+void CSISessionCapture::OnOutput(unsigned char type, const char *ioName, const void *data, int size)
+{
+    if (recordFile_ != NULL)
+        WriteEvent(type, ioName, data, size);
+    
+    if (isReplaying_)
+    {
+        int ioIndex = GetReplayIOIndex(ioName);
+        
+        if (ioIndex < 0)
+            return;
+        
+        CSICaptureEvent event;
+        event.type = type;
+        event.ioIndex = (unsigned char)ioIndex;
+        event.time = g_clock.GetMilliseconds() - replayStartTime_;
+        event.data.assign((const unsigned char *)data, (const unsigned char *)data + size);
+        replayOutput_.push_back(event);
+    }
+}
+
+void CSISessionCapture::FinishReplay()
+{
+    isReplaying_ = false;
+    g_isSessionCaptureActive = recordFile_ != NULL;
+    
+    // compare the output of the replay with the output captured in the field, per IO and in order, timing aside
+    DWORD capturedDuration = replayEvents_.size() > 0 ? replayEvents_.back().time : 0;
+    DWORD replayDuration = g_clock.GetMilliseconds() - replayStartTime_;
+    
+    for (int ioIndex = 0; ioIndex < replayIONames_.size(); ++ioIndex)
+    {
+        int numGolden = 0;
+        int numReplayed = 0;
+        int numMatching = 0;
+        int firstDifference = -1;
+        
+        size_t replayCursor = 0;
+        
+        for (auto &golden : replayEvents_)
+        {
+            if (golden.ioIndex != ioIndex || GetIsInput(golden.type))
+                continue;
+            
+            while (replayCursor < replayOutput_.size() && replayOutput_[replayCursor].ioIndex != ioIndex)
+                replayCursor++;
+            
+            if (replayCursor < replayOutput_.size() && replayOutput_[replayCursor].data == golden.data)
+                numMatching++;
+            else if (firstDifference < 0)
+                firstDifference = numGolden;
+            
+            if (replayCursor < replayOutput_.size())
+                replayCursor++;
+            
+            numGolden++;
+        }
+        
+        for (auto &replayed : replayOutput_)
+            if (replayed.ioIndex == ioIndex)
+                numReplayed++;
+        
+        if (numGolden == numReplayed && numMatching == numGolden)
+            LogToConsole(MEDBUF, "[INFO] Replay %s: output matches, %d messages\n", replayIONames_[ioIndex].c_str(), numGolden);
+        else
+            LogToConsole(MEDBUF, "[INFO] Replay %s: output differs, %d captured %d replayed %d matching, first difference at message %d\n", replayIONames_[ioIndex].c_str(), numGolden, numReplayed, numMatching, firstDifference);
+    }
+    
+    LogToConsole(256, "[INFO] Replay finished in %d ms, captured session was %d ms\n", (int)replayDuration, (int)capturedDuration);
+    
+    replayEvents_.clear();
+    replayOutput_.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSILogQueue
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+char *CSILogQueue::Reserve(int &maxPayloadSize)
+{
+    if (reservedOffset_ >= 0)
+        return NULL;
+    
+    if (maxPayloadSize > s_maxRecordSize_ - (int)sizeof(Record))
+        maxPayloadSize = s_maxRecordSize_ - (int)sizeof(Record);
+    
+    const int recordSize = GetRecordSize(maxPayloadSize);
+    int offset = (int)(writePosition_ % s_capacity_);
+    const int spaceAtEnd = s_capacity_ - offset;
+    
+    // records are contiguous, one that does not fit before the end of the ring starts over at the beginning
+    if (writePosition_ - min(fileReadPosition_, consoleReadPosition_) + (recordSize <= spaceAtEnd ? recordSize : spaceAtEnd + recordSize) > s_capacity_)
+    {
+        numDropped_++;
+        return NULL;
+    }
+    
+    if (recordSize > spaceAtEnd)
+    {
+        Record *skip = (Record *)(buffer_ + offset);
+        skip->size = spaceAtEnd - (int)sizeof(Record);
+        skip->type = CSILogSkip;
+        skip->isInFile = false;
+        writePosition_ += spaceAtEnd;
+        offset = 0;
+    }
+    
+    reservedOffset_ = offset;
+    return buffer_ + offset + sizeof(Record);
+}
+
+void CSILogQueue::Commit(CSILogRecordType type, int payloadSize)
+{
+    if (reservedOffset_ < 0)
+        return;
+    
+    Record *record = (Record *)(buffer_ + reservedOffset_);
+    record->size = payloadSize;
+    record->type = (short)type;
+    record->isInFile = false;
+    time(&record->time);
+    
+#ifdef _DEBUG
+    // errors reach the file before a crash can take the rest of the queue with it
+    if (isLoggingToFile_ && type == CSILogText && payloadSize >= 7 && ! strncmp((const char *)(record + 1), "[ERROR]", 7))
+    {
+        fileText_.clear();
+        AppendTimestamp(record->time, fileText_);
+        fileText_.append((const char *)(record + 1), payloadSize);
+        WriteToFile(fileText_.c_str(), (int)fileText_.size());
+        record->isInFile = true;
+    }
+#endif
+    
+    writePosition_ += GetRecordSize(payloadSize);
+    reservedOffset_ = -1;
+    numRecords_++;
+}
+
+void CSILogQueue::LogMidi(CSILogRecordType type, const char *surfaceName, const unsigned char *bytes, int size)
+{
+    // the bytes are stored as they are and only formatted when drained
+    const int nameLength = (int)min(strlen(surfaceName), (size_t)255);
+    int capacity = 1 + nameLength + size;
+    
+    char *payload = Reserve(capacity);
+    
+    if (payload == NULL)
+        return;
+    
+    if (size > capacity - 1 - nameLength)
+        size = capacity - 1 - nameLength;
+    
+    payload[0] = (char)nameLength;
+    memcpy(payload + 1, surfaceName, nameLength);
+    memcpy(payload + 1 + nameLength, bytes, size);
+    
+    Commit(type, 1 + nameLength + size);
+}
+
+void CSILogQueue::FormatRecord(const Record *record, string &text)
+{
+    const char *payload = (const char *)(record + 1);
+    
+    if (record->type == CSILogText)
+    {
+        text.append(payload, record->size);
+        return;
+    }
+    
+    const int nameLength = (unsigned char)payload[0];
+    const unsigned char *bytes = (const unsigned char *)payload + 1 + nameLength;
+    
+    text += record->type == CSILogMidiIn ? "IN <- " : "OUT->";
+    text.append(payload + 1, nameLength);
+    text += " ";
+    
+    char buf[8];
+    
+    for (int i = 0; i < record->size - 1 - nameLength; ++i)
+    {
+        snprintf(buf, sizeof(buf), "%02x ", bytes[i]);
+        text += buf;
+    }
+    
+    if (record->type == CSILogMidiOut)
+        text += "# Midi_ControlSurface::SendMidiMessage\n";
+    else if (record->type == CSILogMidiSysExOut)
+        text += " # Midi_ControlSurface::SendMidiSysExMessage\n";
+    else
+        text += "\n";
+}
+
+void CSILogQueue::AppendTimestamp(time_t time, string &text)
+{
+    // most records in a Run share a second, localtime and strftime only run when it changes
+    if (time != lastTime_ || timeStr_[0] == 0)
+    {
+        lastTime_ = time;
+        strftime(timeStr_, sizeof(timeStr_), "[%y-%m-%d %H:%M:%S] ", localtime(&time));
+    }
+    
+    text += timeStr_;
+}
+
+void CSILogQueue::Drain(bool isFlushing)
+{
+    if (fileReadPosition_ == writePosition_ && consoleReadPosition_ == writePosition_ && numDropped_ == numDroppedReported_)
+        return;
+    
+    text_.clear();
+    fileText_.clear();
+    
+    while (fileReadPosition_ < writePosition_)
+    {
+        const Record *record = (const Record *)(buffer_ + fileReadPosition_ % s_capacity_);
+        
+        if (isLoggingToFile_ && record->type != CSILogSkip && ! record->isInFile)
+        {
+            AppendTimestamp(record->time, fileText_);
+            FormatRecord(record, fileText_);
+        }
+        
+        fileReadPosition_ += GetRecordSize(record->size);
+    }
+    
+    while (consoleReadPosition_ < writePosition_)
+    {
+        // the console is slow, what does not fit this Run waits for the next one
+        if (isLoggingToConsole_ && ! isFlushing && text_.size() >= s_maxConsoleBytesPerRun_)
+            break;
+        
+        const Record *record = (const Record *)(buffer_ + consoleReadPosition_ % s_capacity_);
+        
+        if (isLoggingToConsole_ && record->type != CSILogSkip)
+            FormatRecord(record, text_);
+        
+        consoleReadPosition_ += GetRecordSize(record->size);
+    }
+    
+    if (numDropped_ > numDroppedReported_)
+    {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "[WARNING] %u log messages dropped, the log queue was full\n", numDropped_ - numDroppedReported_);
+        numDroppedReported_ = numDropped_;
+        
+        if (isLoggingToConsole_)
+            text_ += buf;
+        
+        if (isLoggingToFile_)
+        {
+            time_t rawtime;
+            time(&rawtime);
+            AppendTimestamp(rawtime, fileText_);
+            fileText_ += buf;
+        }
     }
-    catch (const std::exception& e)
+    
+    if (isLoggingToConsole_ && text_.size() > 0)
+        ShowConsoleMsg(text_.c_str());
+    
+    if (isLoggingToFile_ && fileText_.size() > 0)
+        WriteToFile(fileText_.c_str(), (int)fileText_.size());
+}
+
+void CSILogQueue::WriteToFile(const char *text, int size)
+{
+    const string filePath = string(GetResourcePath()) + "/CSI/CSI.log";
+    
+    if (file_ == NULL)
     {
-        LogToConsole(256, "[ERROR] FAILED to PreProcessZoneFile in %s\n", filePath.c_str());
-        LogToConsole(2048, "Exception: %s\n", e.what());
+        file_ = fopenUTF8(filePath.c_str(), "ab");
+        
+        if (file_ == NULL)
+        {
+            isLoggingToFile_ = false;
+            isLoggingToConsole_ = true;
+            ShowConsoleMsg("[ERROR] FAILED to open CSI.log, logging to the console\n");
+            return;
+        }
+        
+        fseek(file_, 0, SEEK_END);
+        fileSize_ = ftell(file_);
+    }
+    
+    fwrite(text, 1, size, file_);
+    fflush(file_);
+    fileSize_ += size;
+    
+    if (fileSize_ > s_maxFileSize_)
+    {
+        fclose(file_);
+        file_ = NULL;
+        
+        const string previousFilePath = string(GetResourcePath()) + "/CSI/CSI.1.log";
+        remove(previousFilePath.c_str());
+        
+        // if the rename fails CSI.log starts over rather than growing without bound
+        if (rename(filePath.c_str(), previousFilePath.c_str()) != 0)
+            if (FILE *file = fopenUTF8(filePath.c_str(), "wb"))
+                fclose(file);
+    }
+}
+
+void CSILogQueue::SetIsLoggingToFile(bool isLoggingToFile)
+{
+    Drain(true);
+    
+    isLoggingToFile_ = isLoggingToFile;
+    isLoggingToConsole_ = ! isLoggingToFile;
+    
+    if ( ! isLoggingToFile_ && file_ != NULL)
+    {
+        fclose(file_);
+        file_ = NULL;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ZoneManager
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+ZoneManager::ZoneManager(CSurfIntegrator *const csi, ControlSurface *surface, const string &zoneFolder, const string &fxZoneFolder) : csi_(csi), surface_(surface), zoneFolder_(zoneFolder), fxZoneFolder_(fxZoneFolder == "" ? zoneFolder : fxZoneFolder) {}
+
+Navigator *ZoneManager::GetNavigatorForTrack(MediaTrack *track) { return surface_->GetPage()->GetNavigatorForTrack(track); }
+Navigator *ZoneManager::GetMasterTrackNavigator() { return surface_->GetPage()->GetMasterTrackNavigator(); }
+Navigator *ZoneManager::GetSelectedTrackNavigator() { return surface_->GetPage()->GetSelectedTrackNavigator(); }
+Navigator *ZoneManager::GetFocusedFXNavigator() { return surface_->GetPage()->GetFocusedFXNavigator(); }
+int ZoneManager::GetNumChannels() { return surface_->GetNumChannels(); }
+
+void ZoneManager::AddToMemoryReport(CSIMemoryReport &report)
+{
+    report.Add("ZoneManager", 1, sizeof(ZoneManager));
+    
+    size_t zoneInfoBytes = 0;
+    
+    for (auto &entry : zoneInfo_)
+        zoneInfoBytes += s_mapNodeOverhead + sizeof(entry) + CSIMemoryReport::GetStringBytes(entry.first) + CSIMemoryReport::GetStringBytes(entry.second.filePath) + CSIMemoryReport::GetStringBytes(entry.second.alias);
+
+    report.Add("ZoneInfo", (int)zoneInfo_.size(), zoneInfoBytes);
+    
+    if (homeZone_ != NULL)
+        homeZone_->AddToMemoryReport(report, "HomeZone");
+    
+    for (auto &goZone : goZones_)
+        goZone->AddToMemoryReport(report, "GoZone");
+    
+    if (focusedFXZone_ != NULL)
+        focusedFXZone_->AddToMemoryReport(report, "FXZone");
+
+    for (auto &selectedTrackFXZone : selectedTrackFXZones_)
+        selectedTrackFXZone->AddToMemoryReport(report, "FXZone");
+
+    if (fxSlotZone_ != NULL)
+        fxSlotZone_->AddToMemoryReport(report, "FXZone");
+
+    if (lastTouchedFXParamZone_ != NULL)
+        lastTouchedFXParamZone_->AddToMemoryReport(report, "FXZone");
+
+    if (learnFocusedFXZone_ != NULL)
+        learnFocusedFXZone_->AddToMemoryReport(report, "LearnZone");
+}
+
+void ZoneManager::Initialize()
+{
+    PreProcessZones();
+
+    if (zoneInfo_.find("Home") == zoneInfo_.end())
+    {
+        char tmp[MEDBUF];
+        snprintf(tmp, sizeof(tmp), __LOCALIZE_VERFMT("%s needs a Home Zone to operate, please recheck your installation", "csi_mbox"), surface_->GetName());
+        MessageBox(g_hwnd, tmp, __LOCALIZE("CSI Missing Home Zone", "csi_mbox"), MB_OK);
+        return;
+    }
+            
+    homeZone_ = make_unique<Zone>(csi_, this, GetSelectedTrackNavigator(), 0, "Home", "Home", zoneInfo_["Home"].filePath);
+    LoadZoneFile(homeZone_.get(), "");
+    
+    vector<string> zoneList;
+    if (zoneInfo_.find("GoZones") != zoneInfo_.end())
+        LoadZoneMetadata(zoneInfo_["GoZones"].filePath.c_str(), zoneList);
+    LoadZones(goZones_, zoneList);
+    
+    if (zoneInfo_.find("LastTouchedFXParam") != zoneInfo_.end())
+    {
+        lastTouchedFXParamZone_ = make_shared<Zone>(csi_, this, GetFocusedFXNavigator(), 0, "LastTouchedFXParam", "LastTouchedFXParam", zoneInfo_["LastTouchedFXParam"].filePath);
+        LoadZoneFile(lastTouchedFXParamZone_.get(), "");
     }
+        
+    homeZone_->Activate();
 }
 
 static ModifierManager s_modifierManager(NULL);
@@ -2763,25 +4572,48 @@ void ZoneManager::LoadZoneFile(Zone *zone, const char *filePath, const char *wid
 
     try
     {
-        ifstream file(filePath);
+        shared_ptr<CSIZoneTemplate> zoneTemplate = csi_->GetZoneTemplateCache().GetZoneTemplate(filePath);
         
-        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] {Z:%s} # LoadZoneFile: %s\n", zone->GetName(), GetRelativePath(filePath));
-        for (string line; getline(file, line) ; )
+        // substituting the suffix token by token gives the same tokens as substituting the line and re-tokenizing,
+        // as long as the suffix is not empty and cannot change where tokens start and end
+        bool canSubstituteTokens = widgetSuffix[0] != 0 && strpbrk(widgetSuffix, " \t\"\\") == NULL;
+        
+        vector<string> suffixedTokens;
+        string suffixedLine;
+        
+        if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(2048, "[DEBUG] {Z:%s} # LoadZoneFile: %s (template cache hit rate %.1f%%)\n", zone->GetName(), GetRelativePath(filePath), csi_->GetZoneTemplateCache().GetHitRate());
+        for (const CSIZoneTemplateLine &templateLine : zoneTemplate->lines)
         {
-            TrimLine(line);
-            
-            lineNumber++;
+            lineNumber = templateLine.lineNumber;
             
-            if (line == "" || (line.size() > 0 && line[0] == '/')) // ignore blank lines and comment lines
-                continue;
+            const vector<string> *lineTokens = &templateLine.tokens;
             
-            if (line == s_BeginAutoSection || line == s_EndAutoSection)
-                continue;
+            if (templateLine.hasWidgetSuffix)
+            {
+                suffixedTokens.clear();
+                
+                if (canSubstituteTokens)
+                {
+                    for (const string &token : templateLine.tokens)
+                    {
+                        suffixedTokens.push_back(token);
+                        ReplaceAllWith(suffixedTokens.back(), "|", widgetSuffix);
+                    }
+                }
+                else
+                {
+                    suffixedLine = templateLine.line;
+                    ReplaceAllWith(suffixedLine, "|", widgetSuffix);
+                    GetTokens(suffixedTokens, suffixedLine);
+                }
+                
+                lineTokens = &suffixedTokens;
+            }
             
-            ReplaceAllWith(line, "|", widgetSuffix);
+            const vector<string> &tokens = *lineTokens;
             
-            vector<string> tokens;
-            GetTokens(tokens, line);
+            if (tokens.size() == 0)
+                continue;
             
             if (tokens[0] == "Zone" || tokens[0] == "ZoneEnd")
                 continue;
@@ -2817,7 +4649,23 @@ void ZoneManager::LoadZoneFile(Zone *zone, const char *filePath, const char *wid
                 bool isDecrease = false;
                 bool isIncrease = false;
                 
-                GetWidgetNameAndModifiers(tokens[0].c_str(), widgetName, modifier, isValueInverted, isFeedbackInverted, hasHoldModifier, HasDoublePressPseudoModifier, isDecrease, isIncrease);
+                if (templateLine.hasWidgetNameAndModifiers && tokens.size() == templateLine.tokens.size())
+                {
+                    widgetName = templateLine.baseWidgetName;
+                    
+                    if (templateLine.hasWidgetSuffix)
+                        ReplaceAllWith(widgetName, "|", widgetSuffix);
+                    
+                    modifier = templateLine.modifier;
+                    isValueInverted = templateLine.isValueInverted;
+                    isFeedbackInverted = templateLine.isFeedbackInverted;
+                    hasHoldModifier = templateLine.hasHoldModifier;
+                    HasDoublePressPseudoModifier = templateLine.hasDoublePressPseudoModifier;
+                    isDecrease = templateLine.isDecrease;
+                    isIncrease = templateLine.isIncrease;
+                }
+                else
+                    GetWidgetNameAndModifiers(tokens[0].c_str(), widgetName, modifier, isValueInverted, isFeedbackInverted, hasHoldModifier, HasDoublePressPseudoModifier, isDecrease, isIncrease);
                 
                 Widget *widget = GetSurface()->GetWidgetByName(widgetName);
                                             
@@ -2910,6 +4758,15 @@ void ZoneManager::SetListenerCategories(PropertyList &pList)
 
 void ZoneManager::CheckFocusedFXState()
 {
+    if (! isFocusedFXMappingEnabled_)
+        return;
+
+    // nothing has changed since the last check
+    if (focusedFXChangeCount_ == csi_->GetFocusedFXChangeCount())
+        return;
+    
+    focusedFXChangeCount_ = csi_->GetFocusedFXChangeCount();
+    
     int trackNumber = 0;
     int itemNumber = 0;
     int takeNumber = 0;
@@ -2918,9 +4775,6 @@ void ZoneManager::CheckFocusedFXState()
     
     bool retVal = GetTouchedOrFocusedFX(1, &trackNumber, &itemNumber, &takeNumber, &fxSlot, &paramIndex);
     
-    if (! isFocusedFXMappingEnabled_)
-        return;
-
     if (! retVal || (retVal && (paramIndex & 0x01)))
     {
         if (focusedFXZone_ != NULL)
@@ -3006,6 +4860,20 @@ void ZoneManager::GoFXSlot(MediaTrack *track, Navigator *navigator, int fxSlot)
         TrackFX_SetOpen(track, fxSlot, true);
 }
 
+void ZoneManager::PrefetchFXZones(MediaTrack *track)
+{
+    // the FX on a newly selected track are the ones most likely to be focused or mapped next
+    for (int i = 0; i < TrackFX_GetCount(track); ++i)
+    {
+        char fxName[MEDBUF];
+        
+        TrackFX_GetFXName(track, i, fxName, sizeof(fxName));
+        
+        if (zoneInfo_.find(fxName) != zoneInfo_.end())
+            csi_->GetZoneTemplateCache().QueuePrefetch(zoneInfo_[fxName].filePath);
+    }
+}
+
 void ZoneManager::UpdateCurrentActionContextModifiers()
 {  
     if (learnFocusedFXZone_ != NULL)
@@ -3041,11 +4909,11 @@ void ZoneManager::PreProcessZones()
         return;
     }
     
-    vector<string>  zoneFilesToProcess;
+    int numZoneFiles = 0;
     
-    listFilesOfType(zoneFolder_ + "/", zoneFilesToProcess, ".zon"); // recursively find all .zon files, starting at zoneFolder
+    PreProcessZoneFolder(zoneFolder_, numZoneFiles);
        
-    if (zoneFilesToProcess.size() == 0)
+    if (numZoneFiles == 0)
     {
         char tmp[2048];
         snprintf(tmp, sizeof(tmp), __LOCALIZE_VERFMT("Please check your installation, cannot find Zone files for %s in:\r\n\r\n%s","csi_mbox"), GetSurface()->GetName(), zoneFolder_.c_str());
@@ -3054,15 +4922,35 @@ void ZoneManager::PreProcessZones()
         return;
     }
           
-    listFilesOfType(fxZoneFolder_ + "/", zoneFilesToProcess, ".zon"); // recursively find all .zon files, starting at fxZoneFolder
-     
-    for (const string &zoneFile : zoneFilesToProcess)
-        PreProcessZoneFile(zoneFile);
+    PreProcessZoneFolder(fxZoneFolder_, numZoneFiles);
+}
+
+void ZoneManager::PreProcessZoneFolder(const string &folder, int &numZoneFiles)
+{
+    // the manifest only opens zone files that are new or changed since it was last built
+    CSIZoneManifest &zoneManifest = csi_->GetZoneManifestCache().GetZoneManifest(folder);
+    
+    for (const CSIZoneManifestEntry &entry : zoneManifest.GetEntries())
+    {
+        numZoneFiles++;
+        
+        if (entry.name == "")
+            continue;
+        
+        CSIZoneInfo info;
+        info.filePath = entry.filePath;
+        info.alias = entry.alias;
+        AddZoneFilePath(entry.name, info);
+    }
 }
 
 void ZoneManager::DoAction(Widget *widget, double value)
 {
     widget->LogInput(value);
+    widget->SetIsActive();
+    
+    if (g_isLatencyTracingEnabled && surface_->GetInputTraceId() != 0)
+        widget->StartLatencyTrace(surface_->GetInputTraceId(), surface_->GetInputTraceStartTime());
     
     bool isUsed = false;
     
@@ -3117,6 +5005,10 @@ void ZoneManager::DoAction(Widget *widget, double value, bool &isUsed)
 void ZoneManager::DoRelativeAction(Widget *widget, double delta)
 {
     widget->LogInput(delta);
+    widget->SetIsActive();
+    
+    if (g_isLatencyTracingEnabled && surface_->GetInputTraceId() != 0)
+        widget->StartLatencyTrace(surface_->GetInputTraceId(), surface_->GetInputTraceStartTime());
     
     bool isUsed = false;
     
@@ -3171,6 +5063,10 @@ void ZoneManager::DoRelativeAction(Widget *widget, double delta, bool &isUsed)
 void ZoneManager::DoRelativeAction(Widget *widget, int accelerationIndex, double delta)
 {
     widget->LogInput(delta);
+    widget->SetIsActive();
+    
+    if (g_isLatencyTracingEnabled && surface_->GetInputTraceId() != 0)
+        widget->StartLatencyTrace(surface_->GetInputTraceId(), surface_->GetInputTraceStartTime());
     
     bool isUsed = false;
     
@@ -3225,6 +5121,7 @@ void ZoneManager::DoRelativeAction(Widget *widget, int accelerationIndex, double
 void ZoneManager::DoTouch(Widget *widget, double value)
 {
     widget->LogInput(value);
+    widget->SetIsTouched(value != 0);
     
     bool isUsed = false;
     
@@ -3318,7 +5215,7 @@ void ModifierManager::SetLatchModifier(bool value, Modifiers modifier, int latch
 {
     if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) {
         const char* modifierName = stringFromModifier(modifier);
-        DWORD keyReleasedTime = GetTickCount();
+        DWORD keyReleasedTime = g_clock.GetMilliseconds();
         DWORD heldTime = keyReleasedTime - modifiers_[modifier].pressedTime;
         if (heldTime >= (DWORD) latchTime) {
             if (modifiers_[modifier].isLocked == true) {
@@ -3341,7 +5238,7 @@ void ModifierManager::SetLatchModifier(bool value, Modifiers modifier, int latch
     } else {
         if (modifiers_[modifier].isEngaged == false) {
             modifiers_[modifier].isEngaged = true;
-            modifiers_[modifier].pressedTime = GetTickCount();
+            modifiers_[modifier].pressedTime = g_clock.GetMilliseconds();
         } else {
             modifiers_[modifier].pressedTime = 0;
         }
@@ -3372,6 +5269,20 @@ void TrackNavigationManager::RebuildTracks()
             page_->ForceClearTrack(i - trackOffset_);
     }
 
+    // invalidate the track color cache once per tick, then drop entries for tracks that are gone
+    trackColorCacheTick_++;
+    
+    if (trackColorCache_.size() > 2 * tracks_.size() + 16)
+    {
+        for (auto it = trackColorCache_.begin(); it != trackColorCache_.end(); )
+        {
+            if (it->second.tick < trackColorCacheTick_ - 1)
+                it = trackColorCache_.erase(it);
+            else
+                ++it;
+        }
+    }
+
     page_->UpdateTrackColors();
 }
 
@@ -3421,6 +5332,82 @@ void TrackNavigationManager::AdjustSelectedTrackBank(int amount)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSITimerWheel
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CSITimerWheel::Arm(ActionContext *actionContext, DWORD dueTime)
+{
+    Cancel(actionContext);
+    
+    // a slot the wheel has already passed this turn would not be visited until the next one,
+    // so a timer due before the next slot to visit goes there, any later one goes in the slot of its due time
+    DWORD slotTime = IsDue(dueTime, nextSlotTime_) ? nextSlotTime_ : dueTime;
+    
+    slots_[GetSlot(slotTime)].push_back(actionContext);
+    dueTimes_[actionContext] = dueTime;
+}
+
+void CSITimerWheel::Cancel(ActionContext *actionContext)
+{
+    if (dueTimes_.erase(actionContext) > 0)
+    {
+        for (auto &slot : slots_)
+        {
+            auto it = find(slot.begin(), slot.end(), actionContext);
+            
+            if (it != slot.end())
+            {
+                slot.erase(it);
+                break;
+            }
+        }
+    }
+    
+    // it may also be waiting to fire in this Run
+    auto it = find(expired_.begin(), expired_.end(), actionContext);
+    
+    if (it != expired_.end())
+        expired_.erase(it);
+}
+
+void CSITimerWheel::Run(DWORD now)
+{
+    if (dueTimes_.size() > 0)
+    {
+        // visit each slot passed since the last Run, never more than one turn
+        DWORD slotTime = nextSlotTime_;
+        
+        for (int i = 0; i < s_numSlots_ && IsDue(slotTime, now); ++i, slotTime += s_slotMs_)
+        {
+            vector<ActionContext *> &slot = slots_[GetSlot(slotTime)];
+            
+            for (int j = 0; j < (int)slot.size(); )
+            {
+                if (IsDue(dueTimes_[slot[j]], now))
+                {
+                    expired_.push_back(slot[j]);
+                    dueTimes_.erase(slot[j]);
+                    slot[j] = slot.back();
+                    slot.pop_back();
+                }
+                else
+                    ++j;
+            }
+        }
+    }
+    
+    // the current slot is visited again next Run, it may hold timers due later in it
+    nextSlotTime_ = now - now % s_slotMs_;
+    
+    // firing may arm, cancel or destroy other contexts, Cancel keeps expired_ up to date
+    while (expired_.size() > 0)
+    {
+        ActionContext *actionContext = expired_.front();
+        expired_.erase(expired_.begin());
+        actionContext->RunDeferredActions();
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ControlSurface
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3450,6 +5437,9 @@ void ControlSurface::Record()
 
 void ControlSurface::OnTrackSelection(MediaTrack *track)
 {
+    if (GetMediaTrackInfo_Value(track, "I_SELECTED"))
+        zoneManager_->PrefetchFXZones(track);
+    
     string onTrackSelection("OnTrackSelection");
     
     if (widgetsByName_.count(onTrackSelection) > 0)
@@ -3475,20 +5465,37 @@ void ControlSurface::UpdateTrackColors()
     bool hasChanged = false;
 
     for (int i = 0; i < trackColors_.size(); ++i)
+    {
+        hasTrackColorChanged_[i] = false;
+        
         if (MediaTrack* track = page_->GetNavigatorForChannel(i + channelOffset_)->GetTrack())
-            if (trackColors_[i] != DAW::GetTrackColor(track))
+        {
+            rgba_color trackColor = page_->GetTrackColor(track);
+            
+            if (trackColors_[i] != trackColor)
             {
                 hasChanged = true;
-                rgba_color trackColor = DAW::GetTrackColor(track);
-                trackColors_[i].r = trackColor.r;
-                trackColors_[i].g = trackColor.g;
-                trackColors_[i].b = trackColor.b;
-                trackColors_[i].a = trackColor.a;
+                hasTrackColorChanged_[i] = true;
+                trackColors_[i] = trackColor;
             }
+        }
+    }
 
-    if (hasChanged)
-        for (auto trackColorFeedbackProcessor : trackColorFeedbackProcessors_)
+    if ( ! hasChanged)
+        return;
+    
+    for (auto trackColorFeedbackProcessor : trackColorFeedbackProcessors_)
+    {
+        int channel = trackColorFeedbackProcessor->GetWidget()->GetChannelNumber() - 1;
+        
+        if (trackColorFeedbackProcessor->IsSingleTrackColor() && channel >= 0 && channel < hasTrackColorChanged_.size())
+        {
+            if (hasTrackColorChanged_[channel])
+                trackColorFeedbackProcessor->ForceUpdateTrackColors();
+        }
+        else
             trackColorFeedbackProcessor->ForceUpdateTrackColors();
+    }
 }
 
 rgba_color ControlSurface::GetTrackColorForChannel(int channel)
@@ -3502,31 +5509,127 @@ rgba_color ControlSurface::GetTrackColorForChannel(int channel)
         return white;
     
     if (MediaTrack *track = page_->GetNavigatorForChannel(channel + channelOffset_)->GetTrack())
-        return DAW::GetTrackColor(track);
+        return page_->GetTrackColor(track);
     else
         return white;
 }
 
-void ControlSurface::RequestUpdate()
+void ControlSurface::BuildUpdatePlan()
 {
     for (auto widget : widgets_)
         widget->ClearHasBeenUsedByUpdate();
+    
+    updatePlan_.entries.clear();
+    updatePlan_.zones.clear();
+    updatePlan_.unusedWidgets.clear();
+    
+    zoneManager_->AddToUpdatePlan(updatePlan_);
+    
+    for (auto widget : widgets_)
+    {
+        if ( ! widget->GetHasBeenUsedByUpdate())
+        {
+            widget->SetHasBeenUsedByUpdate();
+            updatePlan_.unusedWidgets.push_back(widget);
+        }
+    }
+    
+    // lazily resolved modifiers may have bumped the count while building, the plan already reflects them
+    updatePlan_.zoneStateChangeCount = g_zoneStateChangeCount;
+    
+    if (g_debugLevel >= DEBUG_LEVEL_DEBUG) LogToConsole(256, "[DEBUG] [%s] BuildUpdatePlan: %d zones, %d widgets, %d unused\n", name_.c_str(), (int)updatePlan_.zones.size(), (int)updatePlan_.entries.size(), (int)updatePlan_.unusedWidgets.size());
+}
+
+void ControlSurface::AddToMemoryReport(CSIMemoryReport &report)
+{
+    size_t surfaceBytes = sizeof(ControlSurface) + CSIMemoryReport::GetStringBytes(name_) + widgets_.capacity() * sizeof(Widget *);
+    surfaceBytes += updatePlan_.entries.capacity() * sizeof(CSIUpdatePlanEntry) + updatePlan_.zones.capacity() * sizeof(CSIUpdatePlanZone) + updatePlan_.unusedWidgets.capacity() * sizeof(Widget *);
+    report.Add("ControlSurface", 1, surfaceBytes);
+    
+    size_t widgetBytes = 0;
+    int numFeedbackProcessors = 0;
+    
+    for (auto &entry : widgetsByName_)
+    {
+        widgetBytes += s_mapNodeOverhead + sizeof(entry) + CSIMemoryReport::GetStringBytes(entry.first) + entry.second->GetMemoryFootprint();
+        numFeedbackProcessors += (int)entry.second->GetFeedbackProcessors().size();
+    }
+    
+    report.Add("Widget", (int)widgetsByName_.size(), widgetBytes);
+    report.Add("FeedbackProcessor", numFeedbackProcessors, numFeedbackProcessors * sizeof(FeedbackProcessor)); // base class only, derived state varies
+    report.Add("MessageGenerator", (int)CSIMessageGeneratorsByMessage_.size(), CSIMessageGeneratorsByMessage_.size() * (s_mapNodeOverhead + sizeof(pair<const string, unique_ptr<CSIMessageGenerator>>) + sizeof(CSIMessageGenerator)));
+    
+    if (zoneManager_ != NULL)
+        zoneManager_->AddToMemoryReport(report);
+}
 
-    zoneManager_->RequestUpdate();
+void ControlSurface::RunUpdatePlan()
+{
+    DWORD now = g_clock.GetMilliseconds();
+    
+    for (auto &planZone : updatePlan_.zones)
+    {
+        int numEntries = planZone.numEntries;
+        int sliceStart = 0;
+        int sliceEnd = numEntries;
+        
+        // large zones (FX with hundreds of params) poll only a slice of their widgets per Run so the cost stays bounded
+        if (refreshSweepRuns_ > 1 && numEntries >= s_minWidgetsForPartialRefresh)
+        {
+            sliceStart = planZone.zone->GetRefreshCursor();
+            
+            if (sliceStart >= numEntries)
+                sliceStart = 0;
+            
+            sliceEnd = sliceStart + (numEntries + refreshSweepRuns_ - 1) / refreshSweepRuns_;
+            
+            planZone.zone->SetRefreshCursor(sliceEnd % numEntries);
+        }
+        
+        for (int i = 0; i < numEntries; ++i)
+        {
+            CSIUpdatePlanEntry &entry = updatePlan_.entries[planZone.firstEntry + i];
+            
+            bool isInSlice = (i >= sliceStart && i < sliceEnd) || i < sliceEnd - numEntries;
+            bool shouldUpdate = isInSlice || entry.widget->GetIsRecentlyActive(now);
+            
+            if ( ! shouldUpdate)
+                continue;
+            
+            const vector<unique_ptr<ActionContext>> &actionContexts = *entry.actionContexts;
+            
+            for (int j = 0; j < (int)actionContexts.size(); ++j)
+                actionContexts[j]->RequestUpdate();
+            
+            // an action changed the zones under us, the plan is rebuilt next Run
+            if (updatePlan_.zoneStateChangeCount != g_zoneStateChangeCount)
+                return;
+        }
+    }
+    
+    // idle widgets are cleared once, then cost nothing until something updates them again
+    for (auto widget : updatePlan_.unusedWidgets)
+        if ( ! widget->GetIsCleared())
+            widget->Clear();
+}
 
-    const PropertyList properties;
+void ControlSurface::RequestUpdate()
+{
+    timerWheel_.Run(g_clock.GetMilliseconds());
+    
+    zoneManager_->PrepareUpdate();
+    
+    if (updatePlan_.zoneStateChangeCount != g_zoneStateChangeCount)
+        BuildUpdatePlan();
     
-    for (auto &widget : widgets_)
+    RunUpdatePlan();
+    
+    zoneManager_->FinishUpdate();
+    
+    if (ioTelemetrySocket_ != NULL && g_clock.GetMilliseconds() - lastIOTelemetrySendTime_ >= s_ioTelemetryOSCInterval)
     {
-        if ( ! widget->GetHasBeenUsedByUpdate())
-        {
-            widget->SetHasBeenUsedByUpdate();
-            
-            rgba_color color;
-            widget->UpdateValue(properties, 0.0);
-            widget->UpdateValue(properties, "");
-            widget->UpdateColorValue(color);
-        }
+        lastIOTelemetrySendTime_ = g_clock.GetMilliseconds();
+        SendIOTelemetry();
     }
 
     if (isRewinding_)
@@ -3566,6 +5669,93 @@ void ControlSurface::RequestUpdate()
     }
 }
 
+void ControlSurface::BeginInputTrace()
+{
+    inputTraceId_ = csi_->GetNextLatencyTraceId();
+    inputTraceStartTime_ = GetProfilerMicroseconds();
+}
+
+void ControlSurface::ToggleIOTelemetryOSC(const char *destination)
+{
+    if (ioTelemetrySocket_ != NULL)
+    {
+        ioTelemetrySocket_.reset();
+        return;
+    }
+    
+    string address = s_defaultIOTelemetryAddress;
+    int port = s_defaultIOTelemetryPort;
+    
+    if (destination != NULL && destination[0] != 0)
+    {
+        if (const char *colon = strrchr(destination, ':'))
+        {
+            address.assign(destination, colon - destination);
+            port = atoi(colon + 1);
+        }
+        else
+            port = atoi(destination);
+    }
+    
+    unique_ptr<oscpkt::UdpSocket> socket = make_unique<oscpkt::UdpSocket>();
+    
+    if ( ! socket->connectTo(address, port) || ! socket->isOk())
+    {
+        LogToConsole(256, "[ERROR] FAILED to ToggleIOTelemetryOSC, cannot send to %s:%d\n", address.c_str(), port);
+        return;
+    }
+    
+    ioTelemetrySocket_ = std::move(socket);
+    lastIOTelemetrySendTime_ = g_clock.GetMilliseconds() - s_ioTelemetryOSCInterval;
+    
+    if (g_debugLevel >= DEBUG_LEVEL_INFO) LogToConsole(256, "[INFO] %s: sending I/O telemetry to %s:%d\n", name_.c_str(), address.c_str(), port);
+}
+
+void ControlSurface::SendIOTelemetry()
+{
+    // one bundle of /CSI/Telemetry/<Surface>/<Counter> for every surface on the page
+    const DWORD now = g_clock.GetMilliseconds();
+    
+    for (auto &surface : page_->GetSurfaces())
+    {
+        CSIIOTelemetry *telemetry = surface->GetIOTelemetry();
+        
+        if (telemetry == NULL)
+            continue;
+        
+        string surfaceName = surface->GetName();
+        ReplaceAllWith(surfaceName, s_BadFileChars, "_");
+        const string prefix = "/CSI/Telemetry/" + surfaceName + "/";
+        
+        const pair<const char *, int> counters[] =
+        {
+            { "MessagesIn", (int)telemetry->messagesIn },
+            { "BytesIn", (int)telemetry->bytesIn },
+            { "MessagesOut", (int)telemetry->messagesOut },
+            { "BytesOut", (int)telemetry->bytesOut },
+            { "Queued", (int)telemetry->numQueued },
+            { "Deferred", (int)telemetry->numDeferred },
+            { "Dropped", (int)telemetry->numDropped },
+            { "QueueDepth", telemetry->queueDepth },
+            { "PeakQueueDepth", telemetry->peakQueueDepth },
+            { "OldestQueuedAge", telemetry->GetOldestQueuedAge(now) },
+        };
+        
+        ioTelemetryPacketWriter_.init();
+        ioTelemetryPacketWriter_.startBundle();
+        
+        for (auto &counter : counters)
+        {
+            oscpkt::Message message(prefix + counter.first);
+            message.pushInt32(counter.second);
+            ioTelemetryPacketWriter_.addMessage(message);
+        }
+        
+        ioTelemetryPacketWriter_.endBundle();
+        ioTelemetrySocket_->sendPacket(ioTelemetryPacketWriter_.packetData(), ioTelemetryPacketWriter_.packetSize());
+    }
+}
+
 bool ControlSurface::GetShift()
 {
     if (usesLocalModifiers_ || listensToModifiers_)
@@ -3861,6 +6051,9 @@ void ControlSurface::ClearModifiers()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Midi_ControlSurfaceIO::HandleExternalInput(Midi_ControlSurface *surface)
 {
+    CSISessionCapture &sessionCapture = csi_->GetSessionCapture();
+    const bool isReplaying = g_isSessionCaptureActive && sessionCapture.GetIsReplayingIO(name_.c_str());
+    
     if (midiInput_)
     {
         midiInput_->SwapBufsPrecise(GetTickCount(), GetTickCount());
@@ -3868,10 +6061,49 @@ void Midi_ControlSurfaceIO::HandleExternalInput(Midi_ControlSurface *surface)
         int bpos = 0;
         MIDI_event_t *evt;
         while ((evt = list->EnumItems(&bpos)))
+        {
+            if (isReplaying) // live input on an IO in the capture is drained but ignored while the capture is fed back
+                continue;
+            
+            telemetry_.messagesIn++;
+            telemetry_.bytesIn += evt->size;
+            
+            if (g_isSessionCaptureActive)
+                sessionCapture.OnInput(CaptureMidiIn, name_.c_str(), evt->midi_message, evt->size);
+            
             surface->ProcessMidiMessage((MIDI_event_ex_t*)evt);
+        }
+    }
+    
+    if (isReplaying)
+    {
+        struct
+        {
+            MIDI_event_ex_t evt;
+            char data[256];
+        } midiEventData;
+        
+        while (const CSICaptureEvent *event = sessionCapture.GetNextReplayInput(name_.c_str()))
+        {
+            if (event->type != CaptureMidiIn || event->data.size() > 256)
+                continue;
+            
+            telemetry_.messagesIn++;
+            telemetry_.bytesIn += (unsigned int)event->data.size();
+            
+            midiEventData.evt.frame_offset = 0;
+            midiEventData.evt.size = (int)event->data.size();
+            memcpy(midiEventData.evt.midi_message, event->data.data(), event->data.size());
+            surface->ProcessMidiMessage(&midiEventData.evt);
+        }
     }
 }
 
+void Midi_ControlSurfaceIO::CaptureOutput(const unsigned char *data, int size)
+{
+    csi_->GetSessionCapture().OnOutput(CaptureMidiOut, name_.c_str(), data, size);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Midi_ControlSurface
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3886,9 +6118,12 @@ Midi_ControlSurface::Midi_ControlSurface(CSurfIntegrator *const csi, Page *page,
 
 void Midi_ControlSurface::ProcessMidiMessage(const MIDI_event_ex_t *evt)
 {
+    if (g_isLatencyTracingEnabled)
+        BeginInputTrace();
+    
     if (g_surfaceRawInDisplay)
     {
-        LogToConsole(256, "IN <- %s %02x %02x %02x \n", name_.c_str(), evt->midi_message[0], evt->midi_message[1], evt->midi_message[2]);
+        g_logQueue.LogMidi(CSILogMidiIn, name_.c_str(), evt->midi_message, 3);
         // LogStackTraceToConsole();
     }
 
@@ -3903,6 +6138,8 @@ void Midi_ControlSurface::ProcessMidiMessage(const MIDI_event_ex_t *evt)
         CSIMessageGeneratorsByMessage_[twoByteKey]->ProcessMidiMessage(evt);
     else if (CSIMessageGeneratorsByMessage_.find(oneByteKey) != CSIMessageGeneratorsByMessage_.end())
         CSIMessageGeneratorsByMessage_[oneByteKey]->ProcessMidiMessage(evt);
+    
+    EndInputTrace();
 }
 
 void Midi_ControlSurface::SendMidiSysExMessage(MIDI_event_ex_t *midiMessage)
@@ -3910,30 +6147,18 @@ void Midi_ControlSurface::SendMidiSysExMessage(MIDI_event_ex_t *midiMessage)
     surfaceIO_->QueueMidiSysExMessage(midiMessage);
     
     if (g_surfaceOutDisplay)
-    {
-        string output = "OUT->";
-        
-        output += name_ + " ";
-
-        char buf[32];
-
-        for (int i = 0; i < midiMessage->size; ++i)
-        {
-            snprintf(buf, sizeof(buf), "%02x ", midiMessage->midi_message[i]);
-            output += buf;
-        }
-        
-        output += " # Midi_ControlSurface::SendMidiSysExMessage\n";
-
-        ShowConsoleMsg(output.c_str());
-    }
+        g_logQueue.LogMidi(CSILogMidiSysExOut, name_.c_str(), midiMessage->midi_message, midiMessage->size);
 }
 
 void Midi_ControlSurface::SendMidiMessage(int first, int second, int third)
 {
     surfaceIO_->SendMidiMessage(first, second, third);
     
-    if (g_surfaceOutDisplay) LogToConsole(256, "%s %02x %02x %02x # Midi_ControlSurface::SendMidiMessage\n", ("OUT->" + name_).c_str(), first, second, third);
+    if (g_surfaceOutDisplay)
+    {
+        const unsigned char bytes[3] = { (unsigned char)first, (unsigned char)second, (unsigned char)third };
+        g_logQueue.LogMidi(CSILogMidiOut, name_.c_str(), bytes, 3);
+    }
 }
 
  ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -4009,75 +6234,105 @@ OSC_ControlSurfaceIO::~OSC_ControlSurfaceIO()
 
 void OSC_ControlSurfaceIO::HandleExternalInput(OSC_ControlSurface *surface)
 {
+   CSISessionCapture &sessionCapture = csi_->GetSessionCapture();
+   const bool isReplaying = g_isSessionCaptureActive && sessionCapture.GetIsReplayingIO(name_.c_str());
+    
    if (inSocket_ != NULL && inSocket_->isOk())
    {
        while (inSocket_->receiveNextPacket(0))  // timeout, in ms
        {
-           packetReader_.init(inSocket_->packetData(), inSocket_->packetSize());
-           oscpkt::Message *message;
+           if (isReplaying) // live input on an IO in the capture is drained but ignored while the capture is fed back
+               continue;
            
-           while (packetReader_.isOk() && (message = packetReader_.popMessage()) != 0)
-           {
-               if (message->arg().isFloat())
-               {
-                   float value = 0;
-                   message->arg().popFloat(value);
-                   surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
-               }
-               else if (message->arg().isInt32())
-               {
-                   int value;
-                   message->arg().popInt32(value);
-                   surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
-               }
-           }
+           if (g_isSessionCaptureActive)
+               sessionCapture.OnInput(CaptureOSCIn, name_.c_str(), inSocket_->packetData(), inSocket_->packetSize());
+           
+           ProcessPacket(surface, (const char *)inSocket_->packetData(), inSocket_->packetSize());
        }
    }
-}
-
-void OSC_X32ControlSurfaceIO::HandleExternalInput(OSC_ControlSurface *surface)
-{
-   if (inSocket_ != NULL && inSocket_->isOk())
+    
+   if (isReplaying)
    {
-       while (inSocket_->receiveNextPacket(0))  // timeout, in ms
+       while (const CSICaptureEvent *event = sessionCapture.GetNextReplayInput(name_.c_str()))
        {
-           packetReader_.init(inSocket_->packetData(), inSocket_->packetSize());
-           oscpkt::Message *message;
-           
-           while (packetReader_.isOk() && (message = packetReader_.popMessage()) != 0)
-           {
-               if (message->arg().isFloat())
-               {
-                   float value = 0;
-                   message->arg().popFloat(value);
-                   surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
-               }
-               else if (message->arg().isInt32())
-               {
-                   int value;
-                   message->arg().popInt32(value);
-                   
-                   if (message->addressPattern() == "/-stat/selidx")
-                   {
-                       string x32Select = message->addressPattern() + "/";
-                       
-                       if (value < 10)
-                           x32Select += "0";
-
-                       char buf[64];
-                       snprintf(buf, sizeof(buf), "%d", value);
-                       x32Select += buf;
-                                              
-                       surface->ProcessOSCMessage(x32Select.c_str(), 1.0);
-                   }
-                   else
-                       surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
-               }
-           }
+           if (event->type == CaptureOSCIn)
+               ProcessPacket(surface, (const char *)event->data.data(), (int)event->data.size());
        }
    }
 }
 
+void OSC_ControlSurfaceIO::CaptureOutput(const void *p, int sz)
+{
+    csi_->GetSessionCapture().OnOutput(CaptureOSCOut, name_.c_str(), p, sz);
+}
+
+void OSC_ControlSurfaceIO::ProcessPacket(OSC_ControlSurface *surface, const char *packetData, int packetSize)
+{
+    telemetry_.bytesIn += (unsigned int)packetSize;
+    
+    packetReader_.init(packetData, packetSize);
+    oscpkt::Message *message;
+    
+    while (packetReader_.isOk() && (message = packetReader_.popMessage()) != 0)
+    {
+        telemetry_.messagesIn++;
+        
+        if (message->arg().isFloat())
+        {
+            float value = 0;
+            message->arg().popFloat(value);
+            surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
+        }
+        else if (message->arg().isInt32())
+        {
+            int value;
+            message->arg().popInt32(value);
+            surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
+        }
+    }
+}
+
+void OSC_X32ControlSurfaceIO::ProcessPacket(OSC_ControlSurface *surface, const char *packetData, int packetSize)
+{
+    telemetry_.bytesIn += (unsigned int)packetSize;
+    
+    packetReader_.init(packetData, packetSize);
+    oscpkt::Message *message;
+    
+    while (packetReader_.isOk() && (message = packetReader_.popMessage()) != 0)
+    {
+        telemetry_.messagesIn++;
+        
+        if (message->arg().isFloat())
+        {
+            float value = 0;
+            message->arg().popFloat(value);
+            surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
+        }
+        else if (message->arg().isInt32())
+        {
+            int value;
+            message->arg().popInt32(value);
+            
+            if (message->addressPattern() == "/-stat/selidx")
+            {
+                string x32Select = message->addressPattern() + "/";
+                
+                if (value < 10)
+                    x32Select += "0";
+
+                char buf[64];
+                snprintf(buf, sizeof(buf), "%d", value);
+                x32Select += buf;
+                                       
+                surface->ProcessOSCMessage(x32Select.c_str(), 1.0);
+            }
+            else
+                surface->ProcessOSCMessage(message->addressPattern().c_str(), value);
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 // OSC_ControlSurface
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -4091,9 +6346,14 @@ OSC_ControlSurface::OSC_ControlSurface(CSurfIntegrator *const csi, Page *page, c
 
 void OSC_ControlSurface::ProcessOSCMessage(const char *message, double value)
 {
+    if (g_isLatencyTracingEnabled)
+        BeginInputTrace();
+    
     if (CSIMessageGeneratorsByMessage_.find(message) != CSIMessageGeneratorsByMessage_.end())
         CSIMessageGeneratorsByMessage_[message]->ProcessMessage(value);
     
+    EndInputTrace();
+    
     if (g_surfaceInDisplay) LogToConsole(MEDBUF, "IN <- %s %s %f\n", name_.c_str(), message, value);
 }
 
@@ -4233,6 +6493,8 @@ static const char * const Control_Surface_Integrator = "Control Surface Integrat
 
 CSurfIntegrator::CSurfIntegrator()
 {
+    g_logQueue.SetIsDraining(true);
+    
     InitActionsDictionary();
 
     int size = 0;
@@ -4267,6 +6529,9 @@ CSurfIntegrator::~CSurfIntegrator()
     oscSurfacesIO_.clear();
     pages_.clear();
     actions_.clear();
+    
+    g_logQueue.Drain(true);
+    g_logQueue.SetIsDraining(false);
 }
 
 const char *CSurfIntegrator::GetTypeString()
@@ -4285,6 +6550,238 @@ const char *CSurfIntegrator::GetConfigString() // string of configuration data
     return configtmp;
 }
 
+void CSurfIntegrator::ToggleRunProfiling()
+{
+    g_isRunProfilerEnabled = ! g_isRunProfilerEnabled;
+    
+    if ( ! g_isRunProfilerEnabled)
+    {
+        LogToConsole(256, "[INFO] Run profiler stopped\n");
+        return;
+    }
+    
+    // each profiling session starts from empty histograms
+    runPhase_.Reset();
+    
+    for (auto &page : pages_)
+    {
+        page->GetRebuildTracksPhase().Reset();
+        
+        for (auto &surface : page->GetSurfaces())
+        {
+            surface->GetHandleExternalInputPhase().Reset();
+            surface->GetRequestUpdatePhase().Reset();
+            surface->GetFlushIOPhase().Reset();
+        }
+    }
+    
+    LogToConsole(256, "[INFO] Run profiler started\n");
+}
+
+void CSurfIntegrator::ToggleFeedbackLatencyTracing()
+{
+    g_isLatencyTracingEnabled = ! g_isLatencyTracingEnabled;
+    
+    if (g_isLatencyTracingEnabled)
+    {
+        feedbackLatencyHistograms_.clear();
+        numExpiredLatencyTraces_ = 0;
+    }
+    
+    LogToConsole(256, "[INFO] Latency tracing %s\n", g_isLatencyTracingEnabled ? "started" : "stopped");
+}
+
+static void AddRunHistogramLine(string &report, const char *surfaceName, const char *phaseName, CSIRunHistogram &histogram)
+{
+    if (histogram.GetNumSamples() == 0)
+        return;
+    
+    char line[MEDBUF];
+    snprintf(line, sizeof(line), "%-24s %-20s %8u %8d %8d %8d %8d\n", surfaceName, phaseName, histogram.GetNumSamples(), histogram.GetPercentile(50.0), histogram.GetPercentile(95.0), histogram.GetPercentile(99.0), histogram.GetMax());
+    report += line;
+}
+
+static void AddRunPhaseLine(string &report, const char *surfaceName, const char *phaseName, CSIRunPhase &phase)
+{
+    AddRunHistogramLine(report, surfaceName, phaseName, phase.microseconds);
+    
+#ifdef CSI_ALLOCATION_COUNTING
+    if (phase.allocations.GetMax() == 0 || ! GetIsAllocationCountingAvailable())
+        return;
+    
+    string allocationsName = string(phaseName) + " allocs";
+    AddRunHistogramLine(report, surfaceName, allocationsName.c_str(), phase.allocations);
+#endif
+}
+
+void CSurfIntegrator::DumpRunProfile(const char *fileName)
+{
+    string report = "CSI Run profile (microseconds)\n";
+    
+    char line[MEDBUF];
+    snprintf(line, sizeof(line), "%-24s %-20s %8s %8s %8s %8s %8s\n", "Surface", "Phase", "Samples", "p50", "p95", "p99", "max");
+    report += line;
+    
+    AddRunPhaseLine(report, "CSI", "Run", runPhase_);
+    
+    for (auto &page : pages_)
+    {
+        AddRunPhaseLine(report, page->GetName(), "RebuildTracks", page->GetRebuildTracksPhase());
+        
+        for (auto &surface : page->GetSurfaces())
+        {
+            AddRunPhaseLine(report, surface->GetName(), "HandleExternalInput", surface->GetHandleExternalInputPhase());
+            AddRunPhaseLine(report, surface->GetName(), "RequestUpdate", surface->GetRequestUpdatePhase()); // includes FlushIO
+            AddRunPhaseLine(report, surface->GetName(), "FlushIO", surface->GetFlushIOPhase());
+        }
+    }
+    
+    if (feedbackLatencyHistograms_.size() > 0 || numExpiredLatencyTraces_ > 0)
+    {
+        snprintf(line, sizeof(line), "\nInput to feedback latency, %d inputs without a feedback change\n", numExpiredLatencyTraces_);
+        report += line;
+        
+        for (auto &entry : feedbackLatencyHistograms_)
+            AddRunHistogramLine(report, entry.first.c_str(), "Latency", entry.second);
+    }
+    
+#ifdef CSI_ALLOCATION_COUNTING
+    if ( ! GetIsAllocationCountingAvailable())
+        report += "\nAllocs: allocation counting unavailable, CSI's operator new is not the one being called\n";
+#else
+    report += "\nAllocs: n/a, counting is compiled out, build with DEBUG or CSI_COUNT_ALLOCATIONS\n";
+#endif
+    
+    snprintf(line, sizeof(line), "\nLog: %u messages, %u dropped\n", g_logQueue.GetNumRecords(), g_logQueue.GetNumDropped());
+    report += line;
+    
+    if (fileName == NULL || fileName[0] == 0)
+    {
+        LogToConsole((int)report.size() + 1, "%s", report.c_str());
+        return;
+    }
+    
+    string filePath = string(GetResourcePath()) + "/CSI/" + fileName;
+    
+    FILE *file = fopenUTF8(filePath.c_str(), "wb");
+    
+    if ( ! file)
+    {
+        LogToConsole(256, "[ERROR] FAILED to DumpRunProfile, cannot open %s\n", filePath.c_str());
+        return;
+    }
+    
+    fwrite(report.c_str(), 1, report.size(), file);
+    fclose(file);
+    
+    LogToConsole(MEDBUF, "[INFO] Run profile written to %s\n", filePath.c_str());
+}
+
+static void AddMemoryReportLines(string &report, const char *ownerName, const CSIMemoryReport &memoryReport)
+{
+    char line[MEDBUF];
+    
+    for (auto &entry : memoryReport.categories)
+    {
+        snprintf(line, sizeof(line), "%-24s %-20s %8d %12llu\n", ownerName, entry.first.c_str(), entry.second.count, (unsigned long long)entry.second.bytes);
+        report += line;
+    }
+}
+
+void CSurfIntegrator::DumpMemoryReport(const char *fileName)
+{
+    string report = "CSI memory footprint (estimated bytes)\n";
+    
+    char line[MEDBUF];
+    snprintf(line, sizeof(line), "%-24s %-20s %8s %12s\n", "Owner", "Category", "Count", "Bytes");
+    report += line;
+    
+    CSIMemoryReport totals;
+    
+    for (auto &page : pages_)
+    {
+        CSIMemoryReport pageReport;
+        pageReport.Add("Page", 1, sizeof(Page));
+        
+        AddMemoryReportLines(report, page->GetName(), pageReport);
+
+        for (auto &surface : page->GetSurfaces())
+        {
+            CSIMemoryReport surfaceReport;
+            surface->AddToMemoryReport(surfaceReport);
+            
+            AddMemoryReportLines(report, surface->GetName(), surfaceReport);
+            
+            snprintf(line, sizeof(line), "%-24s %-20s %8s %12llu\n", surface->GetName(), "Total", "", (unsigned long long)surfaceReport.GetTotalBytes());
+            report += line;
+            
+            pageReport.Add(surfaceReport);
+        }
+        
+        snprintf(line, sizeof(line), "%-24s %-20s %8s %12llu\n\n", page->GetName(), "Total", "", (unsigned long long)pageReport.GetTotalBytes());
+        report += line;
+        
+        totals.Add(pageReport);
+    }
+    
+    // shared by every page and surface, kept across Init
+    CSIMemoryReport cacheReport;
+    zoneTemplateCache_.AddToMemoryReport(cacheReport);
+    zoneManifestCache_.AddToMemoryReport(cacheReport);
+    fxParamValueCache_.AddToMemoryReport(cacheReport);
+    
+    AddMemoryReportLines(report, "Caches", cacheReport);
+    
+    snprintf(line, sizeof(line), "%-24s %-20s %8s %12llu\n\n", "Caches", "Total", "", (unsigned long long)cacheReport.GetTotalBytes());
+    report += line;
+    
+    totals.Add(cacheReport);
+    
+    AddMemoryReportLines(report, "CSI", totals);
+    
+    snprintf(line, sizeof(line), "%-24s %-20s %8s %12llu\n", "CSI", "Total", "", (unsigned long long)totals.GetTotalBytes());
+    report += line;
+    
+    if (fileName == NULL || fileName[0] == 0)
+    {
+        LogToConsole((int)report.size() + 1, "%s", report.c_str());
+        return;
+    }
+    
+    string filePath = string(GetResourcePath()) + "/CSI/" + fileName;
+    
+    FILE *file = fopenUTF8(filePath.c_str(), "wb");
+    
+    if ( ! file)
+    {
+        LogToConsole(256, "[ERROR] FAILED to DumpMemoryReport, cannot open %s\n", filePath.c_str());
+        return;
+    }
+    
+    fwrite(report.c_str(), 1, report.size(), file);
+    fclose(file);
+    
+    LogToConsole(MEDBUF, "[INFO] Memory report written to %s\n", filePath.c_str());
+}
+
+void CSurfIntegrator::GetIOTelemetryTotals(unsigned int &messagesOut, unsigned int &bytesOut)
+{
+    messagesOut = 0;
+    bytesOut = 0;
+    
+    for (auto &surfaceIO : midiSurfacesIO_)
+    {
+        messagesOut += surfaceIO->GetTelemetry().messagesOut;
+        bytesOut += surfaceIO->GetTelemetry().bytesOut;
+    }
+    
+    for (auto &surfaceIO : oscSurfacesIO_)
+    {
+        messagesOut += surfaceIO->GetTelemetry().messagesOut;
+        bytesOut += surfaceIO->GetTelemetry().bytesOut;
+    }
+}
+
 int CSurfIntegrator::Extended(int call, void *parm1, void *parm2, void *parm3)
 {
     if (call == CSURF_EXT_SUPPORTS_EXTENDED_TOUCH)
@@ -4301,6 +6798,26 @@ int CSurfIntegrator::Extended(int call, void *parm1, void *parm2, void *parm3)
     {
         // parm1=(MediaTrack*)track, whenever FX are added, deleted, or change order
         TrackFXListChanged((MediaTrack*)parm1);
+        OnFXStateChange();
+        fxParamValueCache_.InvalidateTrack((MediaTrack*)parm1);
+    }
+    
+    if (call == CSURF_EXT_SETFOCUSEDFX || call == CSURF_EXT_SETLASTTOUCHEDFX || call == CSURF_EXT_SETFXOPEN)
+    {
+        // acted on by the ZoneManagers on the next Run
+        OnFXStateChange();
+    }
+    
+    if (call == CSURF_EXT_SETFXPARAM)
+    {
+        // touching a param changes it, so this is when the last touched param may have moved
+        isLastTouchedFXDirty_ = true;
+        
+        if (parm1 && parm2)
+        {
+            int fxAndParam = *(int *)parm2;
+            fxParamValueCache_.OnParamChange((MediaTrack *)parm1, (fxAndParam >> 16) & 0xFFFF, fxAndParam & 0xFFFF);
+        }
     }
         
     if (call == CSURF_EXT_SETMIXERSCROLL)
@@ -27,6 +27,8 @@
 #include <iomanip>
 #include <math.h>
 #include <algorithm>
+#include <chrono>
+#include <atomic>
 
 #ifdef _WIN32
 #include "oscpkt.hh"
@@ -100,6 +102,28 @@ extern void InitBlankLearnFocusedFXZone(ZoneManager *zoneManager, Zone *fxZone,
 extern void ShutdownLearn();
 
 extern int g_debugLevel;
+extern int g_zoneStateChangeCount;
+extern bool g_isRunProfilerEnabled;
+extern bool g_isLatencyTracingEnabled;
+extern bool g_isSessionCaptureActive;
+
+// debug and CSI_COUNT_ALLOCATIONS builds replace operator new to count heap allocations made by CSI
+#if defined(_DEBUG) || defined(CSI_COUNT_ALLOCATIONS)
+#define CSI_ALLOCATION_COUNTING 1
+extern std::atomic<long long> g_numAllocations;
+static inline long long GetNumAllocations() { return g_numAllocations.load(std::memory_order_relaxed); }
+
+// false when the replacement is compiled in but not the operator new that gets called, e.g. a .so linked without -Bsymbolic-functions
+static inline bool GetIsAllocationCountingAvailable()
+{
+    const long long numAllocations = GetNumAllocations();
+    ::operator delete(::operator new(1));
+    return GetNumAllocations() != numAllocations;
+}
+#else
+static inline long long GetNumAllocations() { return 0; }
+static inline bool GetIsAllocationCountingAvailable() { return false; }
+#endif
 extern bool g_surfaceRawInDisplay;
 extern bool g_surfaceInDisplay;
 extern bool g_surfaceOutDisplay;
@@ -115,6 +139,54 @@ static const int REAPER__CLOSE_CURRENT_PROJECT_TAB = 40860;
 static const int REAPER__SWITCH_TO_NEXT_PROJECT_TAB = 40862;
 static const int REAPER__SWITCH_TO_PREVIOUS_PROJECT_TAB = 40861;
 
+static const int s_simulatedRunInterval = 33333; // microseconds, REAPER calls Run about 30 times a second
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIClock
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // monotonic time for everything CSI times itself, holds, double presses, latches, throttles, heartbeats, captures,
+    // read once at the start of each Run so everything within a tick sees the same now
+    long long microseconds_ = 0;
+    long long offset_ = 0; // keeps real time from going backwards after running simulated
+    bool isSimulated_ = false;
+    
+    static long long GetSteadyMicroseconds() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+    
+public:
+    CSIClock() : microseconds_(GetSteadyMicroseconds()) {}
+    
+    void Tick()
+    {
+        if (isSimulated_)
+            microseconds_ += s_simulatedRunInterval;
+        else
+            microseconds_ = max(microseconds_, GetSteadyMicroseconds() + offset_);
+    }
+    
+    // simulated time advances exactly one Run interval per Tick, so timing dependent behaviour repeats run to run
+    void SetIsSimulated(bool isSimulated)
+    {
+        if ( ! isSimulated && isSimulated_)
+            offset_ = max(0LL, microseconds_ - GetSteadyMicroseconds());
+        
+        isSimulated_ = isSimulated;
+    }
+    
+    bool GetIsSimulated() { return isSimulated_; }
+    long long GetMicroseconds() { return microseconds_; }
+    DWORD GetMilliseconds() { return (DWORD)(microseconds_ / 1000); } // wraps like GetTickCount, compare differences
+};
+
+extern CSIClock g_clock;
+
+// with SetRefreshSweepRuns > 1, zones with at least s_minWidgetsForPartialRefresh widgets are refreshed round-robin
+// over that many Runs, widgets touched or changed within s_recentWidgetActivityTime ms are refreshed every Run
+static const int s_defaultRefreshSweepRuns = 1; // off
+static const int s_minWidgetsForPartialRefresh = 32;
+static const DWORD s_recentWidgetActivityTime = 1000;
+
 static const char * const s_CSIName = "CSI";
 static const char * const s_CSIVersionDisplay = "v7.0";
 static const char * const s_MajorVersionToken = "7.0";
@@ -340,6 +412,62 @@ class PropertyList
         if (key && value)
             snprintf_append(buf, buf_size, "%s=%s ", key, value);
     }
+    
+    size_t get_heap_bytes() const // strdup'd values that did not fit in RECLEN
+    {
+        size_t bytes = 0;
+        for (int x = 0; x < nprops_; ++x)
+        {
+            const char *p = get_item_ptr((char *)&vals_[x][0]);
+            if (p) bytes += strlen(p) + 1;
+        }
+        return bytes;
+    }
+};
+
+static const size_t s_mapNodeOverhead = 4 * sizeof(void *); // red-black tree links and colour, per std::map entry
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIMemoryCategory
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    int count = 0;
+    size_t bytes = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIMemoryReport
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    // estimates: sizeof plus the heap owned by strings, vectors and maps, allocator overhead is not counted
+    map<string, CSIMemoryCategory> categories;
+    
+    void Add(const char *category, int count, size_t bytes)
+    {
+        CSIMemoryCategory &entry = categories[category];
+        entry.count += count;
+        entry.bytes += bytes;
+    }
+    
+    void Add(const CSIMemoryReport &other)
+    {
+        for (auto &entry : other.categories)
+            Add(entry.first.c_str(), entry.second.count, entry.second.bytes);
+    }
+    
+    size_t GetTotalBytes() const
+    {
+        size_t bytes = 0;
+        for (auto &entry : categories)
+            bytes += entry.second.bytes;
+        return bytes;
+    }
+    
+    static size_t GetStringBytes(const string &value) // short strings live inside the object
+    {
+        static const size_t inlineCapacity = string().capacity();
+        return value.capacity() > inlineCapacity ? value.capacity() + 1 : 0;
+    }
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -497,6 +625,33 @@ public:
     virtual MediaTrack *GetTrack() override;
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSITimerWheel
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // hashed wheel of s_numSlots_ slots, s_slotMs_ wide, timers further out than one turn just stay in their slot
+    // until their due time comes around, only the slots between two Runs are visited
+    static const int s_numSlots_ = 64;
+    static const DWORD s_slotMs_ = 16;
+    
+    vector<ActionContext *> slots_[s_numSlots_];
+    map<ActionContext *, DWORD> dueTimes_;
+    vector<ActionContext *> expired_;
+    DWORD nextSlotTime_ = 0;
+    
+    static int GetSlot(DWORD time) { return (int)((time / s_slotMs_) % s_numSlots_); }
+    static bool IsDue(DWORD dueTime, DWORD now) { return (int)(now - dueTime) >= 0; } // GetTickCount wraps
+    
+public:
+    void Arm(ActionContext *actionContext, DWORD dueTime);
+    void Cancel(ActionContext *actionContext);
+    void Run(DWORD now);
+    
+    int GetNumTimers() { return (int)dueTimes_.size(); }
+    static DWORD GetSlotMs() { return s_slotMs_; } // with Run called every ms, a timer fires at most this late
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class ActionContext
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -541,6 +696,9 @@ private:
     bool holdActive_= false;
     bool holdRepeatActive_ = false;
     double deferredValue_ = 0.0;
+    CSITimerWheel *timerWheel_ = NULL; // set while a hold / repeat timer is armed
+    
+    void ArmDeferredActionTimer();
     
     int  runCount_ = 1;
     
@@ -558,6 +716,10 @@ private:
     string m_freeFormText;
     
     PropertyList widgetProperties_;
+    
+    // what FX param feedback was last sent, see GetIsFXParamFeedbackCurrent
+    int fxParamChangeSerial_ = 0;
+    unsigned int fxParamWidgetWrites_ = 0;
         
     void UpdateTrackColor();
     void GetSteppedValues(Widget *widget, Action *action,  Zone *zone, int paramNumber, const vector<string> &params, const PropertyList &widgetProperties, double &deltaValue, vector<double> &acceleratedDeltaValues, double &rangeMinimum, double &rangeMaximum, vector<double> &steppedValues, vector<int> &acceleratedTickValues);
@@ -569,10 +731,16 @@ public:
     static double constexpr BUTTON_RELEASE_MESSAGE_VALUE = 0.0;
     ActionContext(CSurfIntegrator *const csi, Action *action, Widget *widget, Zone *zone, int paramIndex, const vector<string> &params);
 
-    virtual ~ActionContext() {}
+    virtual ~ActionContext()
+    {
+        if (timerWheel_ != NULL)
+            timerWheel_->Cancel(this);
+    }
     
     CSurfIntegrator *GetCSI() { return csi_; }
     
+    size_t GetMemoryFootprint();
+    
     Action *GetAction() { return action_; }
     Widget *GetWidget() { return widget_; }
     Zone *GetZone() { return zone_; }
@@ -619,6 +787,10 @@ public:
     void ForceWidgetValue(const char *value);
     void UpdateJSFXWidgetSteppedValue(double value);
     void UpdateColorValue(double value);
+    
+    // FX param feedback only needs re-evaluating when the param changed or something else wrote to the widget since
+    bool GetIsFXParamFeedbackCurrent(int changeSerial);
+    void SetFXParamFeedbackSent(int changeSerial);
 
     const char *GetStringParam() { return stringParam_.c_str(); }
     const   vector<double> &GetAcceleratedDeltaValues() { return acceleratedDeltaValues_; }
@@ -753,6 +925,35 @@ public:
     void SetFreeFormText(const char* text) { m_freeFormText = (text ? text : ""); }
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIUpdatePlanEntry
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    Widget *widget = NULL;
+    const vector<unique_ptr<ActionContext>> *actionContexts = NULL; // the contexts for the current modifier / touch / toggle state
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIUpdatePlanZone
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    Zone *zone = NULL;
+    int firstEntry = 0;
+    int numEntries = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIUpdatePlan
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    // the result of walking the active zones in priority order, each widget appears once under the zone that owns it,
+    // rebuilt only when g_zoneStateChangeCount moves (zone activation, modifiers, touch, toggle, zones created or destroyed)
+    vector<CSIUpdatePlanEntry> entries;
+    vector<CSIUpdatePlanZone> zones;
+    vector<Widget *> unusedWidgets;
+    int zoneStateChangeCount = -1;
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class Zone
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -778,13 +979,20 @@ protected:
     vector<unique_ptr<Zone>> includedZones_;
     vector<unique_ptr<Zone>> subZones_;
 
+    int refreshCursor_ = 0; // start of the next round-robin slice, see ControlSurface::RunUpdatePlan
+
     void UpdateCurrentActionContextModifier(Widget *widget);
     
 public:
-    Zone(CSurfIntegrator *const csi, ZoneManager  *const zoneManager, Navigator *navigator, int slotIndex, const string &name, const string &alias, const string &sourceFilePath): csi_(csi), zoneManager_(zoneManager), navigator_(navigator), slotIndex_(slotIndex), name_(name), alias_(alias), sourceFilePath_(sourceFilePath) {}
+    Zone(CSurfIntegrator *const csi, ZoneManager  *const zoneManager, Navigator *navigator, int slotIndex, const string &name, const string &alias, const string &sourceFilePath): csi_(csi), zoneManager_(zoneManager), navigator_(navigator), slotIndex_(slotIndex), name_(name), alias_(alias), sourceFilePath_(sourceFilePath)
+    {
+        g_zoneStateChangeCount++;
+    }
 
     virtual ~Zone()
     {
+        g_zoneStateChangeCount++;
+        
         includedZones_.clear();
         subZones_.clear();
         actionContextDictionary_.clear();
@@ -806,8 +1014,12 @@ public:
     void DoRelativeAction(Widget *widget, bool &isUsed, double delta);
     void DoRelativeAction(Widget *widget, bool &isUsed, int accelerationIndex, double delta);
     void DoTouch(Widget *widget, const char *widgetName, bool &isUsed, double value);
-    void RequestUpdate();
+    void AddToUpdatePlan(CSIUpdatePlan &updatePlan);
+    void AddToMemoryReport(CSIMemoryReport &report, const char *category);
     const vector<Widget *> &GetWidgets() { return widgets_; }
+    
+    int GetRefreshCursor() { return refreshCursor_; }
+    void SetRefreshCursor(int refreshCursor) { refreshCursor_ = refreshCursor; }
 
     const char *GetSourceFilePath() { return sourceFilePath_.c_str(); }
     vector<unique_ptr<Zone>> &GetIncludedZones() { return includedZones_; }
@@ -849,20 +1061,12 @@ public:
     void OnTrackDeselection()
     {
         isActive_ = true;
+        g_zoneStateChangeCount++;
         
         for (auto &includedZone : includedZones_)
             includedZone->Activate();
     }
 
-    void RequestUpdateWidget(Widget *widget)
-    {
-        for (auto &actionContext : GetActionContexts(widget))
-        {
-            actionContext->RunDeferredActions();
-            actionContext->RequestUpdate();
-        }
-    }
-    
     virtual void GoSubZone(const char *subZoneName)
     {
         for (auto &subZone : subZones_)
@@ -918,6 +1122,7 @@ public:
     virtual void ForceValue(const PropertyList &properties, const char * const &value) {}
     virtual void ForceColorValue(const rgba_color &color) {}
     virtual void ForceUpdateTrackColors() {}
+    virtual bool IsSingleTrackColor() { return false; } // true when only the widget's own channel color is sent, otherwise the whole strip is
     virtual void RunDeferredActions() {}
     virtual void ForceClear() {}
     
@@ -987,13 +1192,27 @@ protected:
     string const name_;
     vector<unique_ptr<FeedbackProcessor>> feedbackProcessors_; // owns the objects
     int channelNumber_ = 0;
-    DWORD lastIncomingMessageTime_ = GetTickCount() - 30000;
+    DWORD lastIncomingMessageTime_ = g_clock.GetMilliseconds() - 30000;
     double lastIncomingDelta_ = 0.0;
     
     double stepSize_ = 0.0;
     vector<double> accelerationValues_;
     
     bool hasBeenUsedByUpdate_ = false;
+    bool isCleared_ = false; // no zone uses the widget and it has already been sent its clear values
+    unsigned int numFeedbackWrites_ = 0; // anything handed to the feedback processors, see ActionContext::GetIsFXParamFeedbackCurrent
+    
+    // input or a feedback change, widgets active within s_recentWidgetActivityTime are refreshed every Run
+    DWORD lastActivityTime_ = g_clock.GetMilliseconds() - 30000;
+    bool isTouched_ = false;
+    double lastFeedbackValue_ = 0.0;
+    string lastFeedbackString_; // only kept up to date while the sweep or latency tracing needs it
+    
+    // input to feedback latency trace, started by ZoneManager::DoAction and finished by the next feedback change
+    int latencyTraceId_ = 0; // 0 = no trace in flight
+    long long latencyTraceStartTime_ = 0;
+    
+    void FinishLatencyTrace(bool hasFeedbackChanged);
     
     bool isTwoState_ = false;
 
@@ -1022,10 +1241,18 @@ public:
     
     vector<unique_ptr<FeedbackProcessor>> &GetFeedbackProcessors() { return feedbackProcessors_; }
     
+    size_t GetMemoryFootprint() // the FeedbackProcessors are reported separately
+    {
+        return sizeof(Widget) + CSIMemoryReport::GetStringBytes(name_) + accelerationValues_.capacity() * sizeof(double) + feedbackProcessors_.capacity() * sizeof(unique_ptr<FeedbackProcessor>);
+    }
+    
     void ClearHasBeenUsedByUpdate() { hasBeenUsedByUpdate_ = false; }
     void SetHasBeenUsedByUpdate() { hasBeenUsedByUpdate_ = true; }
     bool GetHasBeenUsedByUpdate() { return hasBeenUsedByUpdate_; }
     
+    bool GetIsCleared() { return isCleared_; }
+    unsigned int GetNumFeedbackWrites() { return numFeedbackWrites_; }
+    
     const char *GetName() { return name_.c_str(); }
     ControlSurface *GetSurface() { return surface_; }
     ZoneManager *GetZoneManager();
@@ -1042,8 +1269,15 @@ public:
     void SetIncomingMessageTime(int lastIncomingMessageTime) { lastIncomingMessageTime_ = lastIncomingMessageTime; }
     int GetLastIncomingMessageTime() { return lastIncomingMessageTime_; }
     
+    void SetIsTouched(bool isTouched) { isTouched_ = isTouched; SetIsActive(); }
+    void SetIsActive() { lastActivityTime_ = g_clock.GetMilliseconds(); }
+    bool GetIsRecentlyActive(DWORD now) { return isTouched_ || now - lastActivityTime_ < s_recentWidgetActivityTime; }
+    
     void SetLastIncomingDelta(double delta) { lastIncomingDelta_ = delta; }
     double GetLastIncomingDelta() { return lastIncomingDelta_; }
+    
+    void StartLatencyTrace(int traceId, long long startTime) { latencyTraceId_ = traceId; latencyTraceStartTime_ = startTime; }
+    const char *GetLatencyTraceClass() { return feedbackProcessors_.size() > 0 ? feedbackProcessors_[0]->GetName() : "NoFeedback"; }
 
     void Configure(const vector<unique_ptr<ActionContext>> &contexts);
     void UpdateValue(const PropertyList &properties, double value);
@@ -1054,6 +1288,7 @@ public:
     void SetXTouchDisplayColors(const char *colors);
     void RestoreXTouchDisplayColors();
     void ForceClear();
+    void Clear();
 
     void SetHasDoublePressActions() { hasDoublePressActions_ = true; };
     bool HasDoublePressActions() { return hasDoublePressActions_; };
@@ -1075,6 +1310,458 @@ struct CSIZoneInfo
     string alias;
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIZoneTemplateLine
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    int lineNumber = 0;
+    bool hasWidgetSuffix = false;   // line contains the | placeholder, substituted per channel when the zone is loaded
+    string line;                    // only kept when hasWidgetSuffix, to re-tokenize exactly when the suffix is empty
+    vector<string> tokens;
+    
+    // pre-parsed first token, valid when the | placeholder can only affect the base widget name
+    bool hasWidgetNameAndModifiers = false;
+    string baseWidgetName;
+    int modifier = 0;
+    bool isValueInverted = false;
+    bool isFeedbackInverted = false;
+    bool hasHoldModifier = false;
+    bool hasDoublePressPseudoModifier = false;
+    bool isDecrease = false;
+    bool isIncrease = false;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIZoneTemplate
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    string filePath;
+    filesystem::file_time_type lastWriteTime;
+    uintmax_t fileSize = 0;
+    vector<CSIZoneTemplateLine> lines;
+    long long lastUsed = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIZoneTemplateCache
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // .zon files are parsed once and shared by every channel, surface and page that loads them,
+    // a template is only re-parsed when the file's size or modification time changes
+    map<const string, shared_ptr<CSIZoneTemplate>> zoneTemplates_;
+    
+    // FX zones get loaded on every focus, FX slot and selected track FX change, so the least recently used
+    // templates are dropped once there are more than this, zones already loaded keep their own copy of what they need
+    static const int s_capacity_ = 256;
+    long long useCounter_ = 0;
+    
+    int numCompiled_ = 0;
+    int numReused_ = 0;
+    int numHits_ = 0;   // lifetime, for the hit rate
+    int numMisses_ = 0;
+    int numPrefetched_ = 0; // lifetime, reported by Init
+    bool isDirty_ = false; // templates were compiled since the cache file was last loaded or saved
+    
+    // zone files likely to be loaded soon, compiled a few per Run so they are ready before they are needed
+    vector<string> prefetchQueue_;
+    
+    shared_ptr<CSIZoneTemplate> CompileZoneTemplate(const string &filePath, filesystem::file_time_type lastWriteTime, uintmax_t fileSize);
+    void EvictLeastRecentlyUsed();
+    bool IsCurrent(const string &filePath, filesystem::file_time_type &lastWriteTime, uintmax_t &fileSize);
+
+public:
+    shared_ptr<CSIZoneTemplate> GetZoneTemplate(const string &filePath);
+    
+    void QueuePrefetch(const string &filePath);
+    void RunPrefetch(int maxFilesToCompile);
+    
+    // compiled templates are persisted between sessions, entries are checked against the zone file's size and modification time on use
+    void LoadFromFile(const string &cacheFilePath);
+    void SaveToFile(const string &cacheFilePath);
+    
+    void Clear() { zoneTemplates_.clear(); isDirty_ = false; }
+    void ResetStats() { numCompiled_ = 0; numReused_ = 0; }
+    int GetNumTemplates() { return (int)zoneTemplates_.size(); }
+    int GetNumCompiled() { return numCompiled_; }
+    int GetNumReused() { return numReused_; }
+    double GetHitRate() { return numHits_ + numMisses_ > 0 ? 100.0 * numHits_ / (numHits_ + numMisses_) : 0.0; }
+    int GetNumPrefetched() { return numPrefetched_; }
+    
+    void AddToMemoryReport(CSIMemoryReport &report);
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIZoneManifestEntry
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    string filePath;
+    filesystem::file_time_type lastWriteTime;
+    uintmax_t fileSize = 0;
+    string name;    // empty when the file has no Zone line
+    string alias;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIZoneManifest
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    string const folder_;
+    vector<CSIZoneManifestEntry> entries_; // in directory listing order
+    bool needsUpdate_ = true;
+    
+    static void ReadZoneHeader(CSIZoneManifestEntry &entry);
+
+public:
+    CSIZoneManifest(const string &folder) : folder_(folder) {}
+    
+    // compares the directory listing with the previous one, only new or changed files are opened, returns true if anything changed
+    bool Update(int &numFilesRead, int &numFilesReused);
+    
+    const string &GetFolder() { return folder_; }
+    vector<CSIZoneManifestEntry> &GetEntries() { return entries_; }
+    bool GetNeedsUpdate() { return needsUpdate_; }
+    void SetNeedsUpdate() { needsUpdate_ = true; }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIZoneManifestCache
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // one manifest per zone folder, shared by every surface and page that uses the folder
+    map<const string, unique_ptr<CSIZoneManifest>> zoneManifests_;
+    
+    int numFilesRead_ = 0;
+    int numFilesReused_ = 0;
+    bool isDirty_ = false;
+
+public:
+    CSIZoneManifest &GetZoneManifest(const string &folder);
+    
+    void LoadFromFile(const string &cacheFilePath);
+    void SaveToFile(const string &cacheFilePath);
+    
+    void InvalidateAll()
+    {
+        for (auto &zoneManifest : zoneManifests_)
+            zoneManifest.second->SetNeedsUpdate();
+    }
+    
+    void ResetStats() { numFilesRead_ = 0; numFilesReused_ = 0; }
+    int GetNumManifests() { return (int)zoneManifests_.size(); }
+    int GetNumFilesRead() { return numFilesRead_; }
+    int GetNumFilesReused() { return numFilesReused_; }
+    
+    void AddToMemoryReport(CSIMemoryReport &report);
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIFXParamKey
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    MediaTrack *track = NULL;
+    int fxSlot = 0;
+    int paramIndex = 0;
+    
+    bool operator<(const CSIFXParamKey &other) const
+    {
+        if (track != other.track)
+            return track < other.track;
+        if (fxSlot != other.fxSlot)
+            return fxSlot < other.fxSlot;
+        return paramIndex < other.paramIndex;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIFXParamValue
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    double value = 0.0;
+    bool isValid = false;
+    int lastReadTick = 0;
+    int changeSerial = 0; // a new one from CSIFXParamValueCache each time the value is read and differs, 0 = never read
+    
+    // display strings, the formatted value is only good for the normalized value it was formatted from
+    string formattedValue;
+    double formattedValueSource = 0.0;
+    bool isFormattedValueValid = false;
+    
+    string name;
+    bool isNameValid = false;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIFXParamValueCache
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // normalized values of the FX params currently mapped on any surface, REAPER tells us about changes through
+    // CSURF_EXT_SETFXPARAM, a few entries are re-read each Run for plugins that change params without notifying
+    map<CSIFXParamKey, CSIFXParamValue> fxParamValues_;
+    CSIFXParamKey refreshCursor_;
+    int tick_ = 0;
+    int changeSerial_ = 0;
+    
+    int numDisplayHits_ = 0;
+    int numDisplayMisses_ = 0;
+    
+    CSIFXParamValue &GetEntry(MediaTrack *track, int fxSlot, int paramIndex);
+    double GetParamNormalized(CSIFXParamValue &fxParamValue, MediaTrack *track, int fxSlot, int paramIndex);
+    
+public:
+    double GetParamNormalized(MediaTrack *track, int fxSlot, int paramIndex);
+    int GetChangeSerial(MediaTrack *track, int fxSlot, int paramIndex);
+    const char *GetFormattedParamValue(MediaTrack *track, int fxSlot, int paramIndex);
+    const char *GetParamName(MediaTrack *track, int fxSlot, int paramIndex);
+    
+    void OnParamChange(MediaTrack *track, int fxSlot, int paramIndex);
+    void InvalidateTrack(MediaTrack *track);
+    void Clear() { fxParamValues_.clear(); }
+    
+    void Run();
+    
+    int GetNumParams() { return (int)fxParamValues_.size(); }
+    
+    void AddToMemoryReport(CSIMemoryReport &report);
+    double GetDisplayHitRate() { return numDisplayHits_ + numDisplayMisses_ > 0 ? 100.0 * numDisplayHits_ / (numDisplayHits_ + numDisplayMisses_) : 0.0; }
+};
+
+static inline long long GetProfilerMicroseconds() // only the differences are narrowed to int
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const int s_numRunHistogramBuckets = 120;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIRunHistogram
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // durations in microseconds, exact below 8 us, above that 4 buckets per power of two (<= 25% error),
+    // fixed size so recording never allocates
+    unsigned int buckets_[s_numRunHistogramBuckets] = {};
+    unsigned int numSamples_ = 0;
+    int maxMicroseconds_ = 0;
+    
+    static int GetBucketIndex(int microseconds)
+    {
+        if (microseconds < 8)
+            return microseconds < 0 ? 0 : microseconds;
+        
+        int octave = 0;
+        for (unsigned int value = microseconds; value > 1; value >>= 1)
+            octave++;
+        
+        return 8 + (octave - 3) * 4 + ((microseconds >> (octave - 2)) & 3);
+    }
+    
+    static int GetBucketUpperBound(int bucketIndex)
+    {
+        if (bucketIndex < 8)
+            return bucketIndex;
+        
+        int octave = 3 + (bucketIndex - 8) / 4;
+        int step = 1 << (octave - 2);
+        
+        return (1 << octave) + ((bucketIndex - 8) % 4) * step + step - 1;
+    }
+    
+public:
+    void Record(int microseconds)
+    {
+        buckets_[GetBucketIndex(microseconds)]++;
+        numSamples_++;
+        
+        if (microseconds > maxMicroseconds_)
+            maxMicroseconds_ = microseconds;
+    }
+    
+    int GetPercentile(double percentile)
+    {
+        if (numSamples_ == 0)
+            return 0;
+        
+        unsigned int target = (unsigned int)ceil(numSamples_ * percentile / 100.0);
+        unsigned int count = 0;
+        
+        for (int i = 0; i < s_numRunHistogramBuckets; ++i)
+        {
+            count += buckets_[i];
+            
+            if (count >= target)
+                return min(GetBucketUpperBound(i), maxMicroseconds_);
+        }
+        
+        return maxMicroseconds_;
+    }
+    
+    void Reset()
+    {
+        memset(buckets_, 0, sizeof(buckets_));
+        numSamples_ = 0;
+        maxMicroseconds_ = 0;
+    }
+    
+    unsigned int GetNumSamples() { return numSamples_; }
+    int GetMax() { return maxMicroseconds_; }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIRunPhaseStart
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    long long time;
+    long long numAllocations;
+    
+    CSIRunPhaseStart(bool isProfiling = true) : time(isProfiling ? GetProfilerMicroseconds() : 0), numAllocations(isProfiling ? GetNumAllocations() : 0) {}
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIRunPhase
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    CSIRunHistogram microseconds;
+    CSIRunHistogram allocations; // per tick, all zero unless CSI_ALLOCATION_COUNTING
+    
+    void Record(int elapsedMicroseconds, long long numAllocations)
+    {
+        microseconds.Record(elapsedMicroseconds);
+        allocations.Record((int)numAllocations);
+    }
+    
+    void Record(const CSIRunPhaseStart &start) { Record((int)(GetProfilerMicroseconds() - start.time), GetNumAllocations() - start.numAllocations); }
+    
+    void Reset()
+    {
+        microseconds.Reset();
+        allocations.Reset();
+    }
+};
+
+static const int s_ioTelemetryOSCInterval = 1000; // ms between telemetry sends when ToggleIOTelemetryOSC is on
+static const char * const s_defaultIOTelemetryAddress = "127.0.0.1";
+static const int s_defaultIOTelemetryPort = 9100;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIIOTelemetry
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    // running totals for one surface IO, messages are MIDI events or OSC messages in, MIDI events or OSC packets out
+    unsigned int messagesIn = 0;
+    unsigned int bytesIn = 0;
+    unsigned int messagesOut = 0;
+    unsigned int bytesOut = 0;
+    
+    unsigned int numQueued = 0;   // held back because of MaxMessagesPerRun / MaxPacketsPerRun, each message counted once
+    unsigned int numDeferred = 0; // still queued at the end of a Run, summed per tick, so a backlog shows up here
+    unsigned int numDropped = 0;
+    
+    int queueDepth = 0;
+    int peakQueueDepth = 0;
+    int heldBackDepth = 0; // MIDI, queue depth left at the end of the last Run
+    DWORD oldestQueuedTime = 0; // g_clock.GetMilliseconds() of the item at the head of the queue, only valid with queueDepth > 0
+    
+    void OnQueued()
+    {
+        numQueued++;
+        
+        if (++queueDepth > peakQueueDepth)
+            peakQueueDepth = queueDepth;
+    }
+    
+    // MIDI SysEx always goes through the queue and is sent from Run, so only what is left once the
+    // per Run budget is used up counts as queued, the queue is FIFO so what was held back before goes first
+    void OnMidiRunEnd(int numSent)
+    {
+        numQueued += queueDepth - max(0, heldBackDepth - numSent);
+        
+        if (queueDepth > peakQueueDepth)
+            peakQueueDepth = queueDepth;
+        
+        heldBackDepth = queueDepth;
+    }
+    
+    int GetOldestQueuedAge(DWORD now) { return queueDepth > 0 ? (int)(now - oldestQueuedTime) : 0; }
+    
+    void Reset()
+    {
+        const int currentQueueDepth = queueDepth;
+        const int currentHeldBackDepth = heldBackDepth;
+        const DWORD currentOldestQueuedTime = oldestQueuedTime;
+        
+        *this = CSIIOTelemetry();
+        
+        queueDepth = peakQueueDepth = currentQueueDepth;
+        heldBackDepth = currentHeldBackDepth;
+        oldestQueuedTime = currentOldestQueuedTime;
+    }
+};
+
+enum CSICaptureEventType { CaptureIOName = 0, CaptureMidiIn, CaptureOSCIn, CaptureMidiOut, CaptureOSCOut };
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSICaptureEvent
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    unsigned char type = 0;
+    unsigned char ioIndex = 0;
+    DWORD time = 0; // ms since the capture started
+    vector<unsigned char> data; // MIDI message bytes or a raw OSC packet
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSISessionCapture
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // records everything the surface IOs receive and send, keyed by IO name, so a session from the field can be
+    // fed back through HandleExternalInput and its output compared with what was sent originally
+    FILE *recordFile_ = NULL;
+    string recordFilePath_;
+    DWORD recordStartTime_ = 0;
+    vector<string> recordIONames_;
+    
+    bool isReplaying_ = false;
+    bool isReplayStopRequested_ = false;
+    bool isReplayAsFastAsPossible_ = false;
+    vector<CSICaptureEvent> replayEvents_;
+    vector<string> replayIONames_;
+    vector<size_t> replayCursors_; // per IO, the next input event to feed
+    DWORD replayStartTime_ = 0;
+    DWORD replayTime_ = 0;
+    int replayFinishTicks_ = 0;
+    vector<CSICaptureEvent> replayOutput_;
+    
+    int GetReplayIOIndex(const char *ioName);
+    bool GetIsInput(unsigned char type) { return type == CaptureMidiIn || type == CaptureOSCIn; }
+    const CSICaptureEvent *PeekReplayInput(int ioIndex);
+    void WriteEvent(unsigned char type, const char *ioName, const void *data, int size);
+    bool LoadReplay(const string &filePath);
+    void FinishReplay();
+    
+public:
+    ~CSISessionCapture() { StopRecording(); }
+    
+    bool StartRecording(const string &filePath);
+    void StopRecording();
+    bool GetIsRecording() { return recordFile_ != NULL; }
+    
+    bool StartReplay(const string &filePath, bool asFastAsPossible);
+    void StopReplay();
+    bool GetIsReplaying() { return isReplaying_; }
+    bool GetIsReplayingIO(const char *ioName) { return isReplaying_ && GetReplayIOIndex(ioName) >= 0; } // live input on other IOs still gets through
+    
+    void Run();
+    
+    void OnInput(unsigned char type, const char *ioName, const void *data, int size) { if (recordFile_ != NULL) WriteEvent(type, ioName, data, size); }
+    void OnOutput(unsigned char type, const char *ioName, const void *data, int size);
+    const CSICaptureEvent *GetNextReplayInput(const char *ioName);
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class ZoneManager
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1111,6 +1798,7 @@ private:
     
     shared_ptr<Zone> focusedFXZone_ = NULL;
     bool isFocusedFXMappingEnabled_ = true;
+    int focusedFXChangeCount_ = -1; // last CSurfIntegrator focused FX change count acted on, -1 forces a check
     
     vector<shared_ptr<Zone>> selectedTrackFXZones_;
     shared_ptr<Zone> fxSlotZone_ = NULL;
@@ -1125,7 +1813,6 @@ private:
 
     void GoFXSlot(MediaTrack *track, Navigator *navigator, int fxSlot);
     void GoSelectedTrackFX();
-    void GetWidgetNameAndModifiers(const string &line, string &baseWidgetName, int &modifier, bool &isValueInverted, bool &isFeedbackInverted, bool &hasHoldModifier, bool &HasDoublePressPseudoModifier, bool &isDecrease, bool &isIncrease);
     void GetNavigatorsForZone(const char *zoneName, const char *navigatorName, vector<Navigator *> &navigators);
     void LoadZones(vector<unique_ptr<Zone>> &zones, vector<string> &zoneList);
          
@@ -1271,6 +1958,7 @@ private:
     void ToggleEnableLastTouchedFXParamMapping()
     {
         isLastTouchedFXParamMappingEnabled_ = ! isLastTouchedFXParamMappingEnabled_;
+        g_zoneStateChangeCount++;
         
         if (lastTouchedFXParamZone_ != NULL)
         {
@@ -1289,6 +1977,7 @@ private:
     void ToggleEnableFocusedFXMapping()
     {
         isFocusedFXMappingEnabled_ = ! isFocusedFXMappingEnabled_;
+        focusedFXChangeCount_ = -1;
     }
 
     void ClearLastTouchedFXParam()
@@ -1309,6 +1998,8 @@ private:
             zonesToBeDeleted_.push_back(focusedFXZone_);
             focusedFXZone_ = NULL;
         }
+        
+        focusedFXChangeCount_ = -1; // a plugin that is still focused gets its zone back on the next Run
     }
         
     void ClearSelectedTrackFX()
@@ -1378,13 +2069,16 @@ public:
     
     int  GetNumChannels();
     
+    static void GetWidgetNameAndModifiers(const string &line, string &baseWidgetName, int &modifier, bool &isValueInverted, bool &isFeedbackInverted, bool &hasHoldModifier, bool &HasDoublePressPseudoModifier, bool &isDecrease, bool &isIncrease);
+
     void PreProcessZones();
-    void PreProcessZoneFile(const string &filePath);
+    void PreProcessZoneFolder(const string &folder, int &numZoneFiles);
     void LoadZoneFile(Zone *zone, const char *widgetSuffix);
     void LoadZoneFile(Zone *zone, const char *filePath, const char *widgetSuffix);
 
     void UpdateCurrentActionContextModifiers();
     void CheckFocusedFXState();
+    void PrefetchFXZones(MediaTrack *track);
 
     void DoAction(Widget *widget, double value);
     void DoRelativeAction(Widget *widget, double delta);
@@ -1678,6 +2372,7 @@ public:
     void DisableLastTouchedFXParamMapping()
     {
         isLastTouchedFXParamMappingEnabled_ = false;
+        g_zoneStateChangeCount++;
     }
     
     void DeclareToggleEnableFocusedFXMapping()
@@ -1692,6 +2387,7 @@ public:
     void DisableFocusedFXMapping()
     {
         isFocusedFXMappingEnabled_ = false;
+        focusedFXChangeCount_ = -1;
     }
     
     bool GetIsGoZoneActive(const char *zoneName)
@@ -1751,34 +2447,43 @@ public:
         }
     }
 
-    void RequestUpdate()
+    void PrepareUpdate()
     {
         CheckFocusedFXState();
           
         if (learnFocusedFXZone_ != NULL)
-        {
             UpdateLearnWindow(this);
-            learnFocusedFXZone_->RequestUpdate();
-        }
+    }
+    
+    // the order here is the update priority, a widget belongs to the first active zone that contains it
+    void AddToUpdatePlan(CSIUpdatePlan &updatePlan)
+    {
+        if (learnFocusedFXZone_ != NULL)
+            learnFocusedFXZone_->AddToUpdatePlan(updatePlan);
 
         if (lastTouchedFXParamZone_ != NULL && isLastTouchedFXParamMappingEnabled_)
-            lastTouchedFXParamZone_->RequestUpdate();
+            lastTouchedFXParamZone_->AddToUpdatePlan(updatePlan);
 
         if (focusedFXZone_ != NULL)
-            focusedFXZone_->RequestUpdate();
+            focusedFXZone_->AddToUpdatePlan(updatePlan);
         
         for (int i = 0; i < selectedTrackFXZones_.size(); ++i)
-            selectedTrackFXZones_[i]->RequestUpdate();
+            selectedTrackFXZones_[i]->AddToUpdatePlan(updatePlan);
         
         if (fxSlotZone_ != NULL)
-            fxSlotZone_->RequestUpdate();
+            fxSlotZone_->AddToUpdatePlan(updatePlan);
         
         for (int i = 0; i < goZones_.size(); ++i)
-            goZones_[i]->RequestUpdate();
+            goZones_[i]->AddToUpdatePlan(updatePlan);
 
         if (homeZone_ != NULL)
-            homeZone_->RequestUpdate();
-        
+            homeZone_->AddToUpdatePlan(updatePlan);
+    }
+    
+    void AddToMemoryReport(CSIMemoryReport &report);
+    
+    void FinishUpdate()
+    {
         zonesToBeDeleted_.clear();
     }
 };
@@ -2155,9 +2860,30 @@ private:
         
     int latchTime_ = 100;
     int doublePressTime_ = 400;
+    int refreshSweepRuns_ = s_defaultRefreshSweepRuns;
+    
+    CSIUpdatePlan updatePlan_;
+    
+    // declared ahead of zoneManager_ so it outlives the ActionContexts that may still be armed
+    CSITimerWheel timerWheel_;
+    
+    CSIRunPhase handleExternalInputPhase_;
+    CSIRunPhase requestUpdatePhase_;
+    
+    // telemetry goes to a monitoring address of its own, never through a surface IO, so it does not count itself
+    unique_ptr<oscpkt::UdpSocket> ioTelemetrySocket_; // NULL = not sending
+    oscpkt::PacketWriter ioTelemetryPacketWriter_;
+    DWORD lastIOTelemetrySendTime_ = 0;
+    
+    int inputTraceId_ = 0;
+    long long inputTraceStartTime_ = 0;
+    
+    void BuildUpdatePlan();
+    void RunUpdatePlan();
     
     vector<FeedbackProcessor *> trackColorFeedbackProcessors_; // does not own pointers
     vector<rgba_color> trackColors_;
+    vector<bool> hasTrackColorChanged_;
 
     vector<ChannelTouch> channelTouches_;
     vector<ChannelToggle> channelToggles_;
@@ -2174,6 +2900,8 @@ protected:
     
     void ProcessValues(const vector<vector<string>> &lines);
     
+    CSIRunPhase flushIOPhase_; // output queues drained during RequestUpdate, recorded by the derived surfaces
+    
     CSurfIntegrator *const csi_;
     Page *const page_;
     string const name_;
@@ -2310,6 +3038,18 @@ public:
     virtual void HandleExternalInput() {}
     virtual void UpdateTimeDisplay() {}
     virtual void FlushIO() {}
+    virtual CSIIOTelemetry *GetIOTelemetry() { return NULL; }
+    virtual bool GetIsOSC() { return false; }
+    
+    // only called while g_isLatencyTracingEnabled is set, the trace is attached to the widget the input reaches
+    void BeginInputTrace();
+    int GetInputTraceId() { return inputTraceId_; }
+    long long GetInputTraceStartTime() { return inputTraceStartTime_; }
+    void EndInputTrace() { inputTraceId_ = 0; }
+    
+    void ToggleIOTelemetryOSC(const char *destination); // [address:]port, empty = s_defaultIOTelemetryAddress:s_defaultIOTelemetryPort
+    bool GetIsSendingIOTelemetry() { return ioTelemetrySocket_ != NULL; }
+    void SendIOTelemetry();
     
     virtual void SendMidiSysExMessage(MIDI_event_ex_t *midiMessage) {}
     virtual void SendMidiMessage(int first, int second, int third) {}
@@ -2319,6 +3059,8 @@ public:
     Page *GetPage() { return page_; }
     const char *GetName() { return name_.c_str(); }
     
+    void AddToMemoryReport(CSIMemoryReport &report);
+    
     int GetNumChannels() { return numChannels_; }
     int GetChannelOffset() { return channelOffset_; }
     rgba_color GetTrackColorForChannel(int channel);
@@ -2339,6 +3081,30 @@ public:
     
     void SetDoublePressTime(int doublePressTime) { doublePressTime_ = doublePressTime; }
     int GetDoublePressTime() { return doublePressTime_; }
+    
+    CSITimerWheel &GetTimerWheel() { return timerWheel_; }
+    
+    // Run profiler, only called while g_isRunProfilerEnabled is set
+    void HandleExternalInputProfiled()
+    {
+        const CSIRunPhaseStart start;
+        HandleExternalInput();
+        handleExternalInputPhase_.Record(start);
+    }
+    
+    void RequestUpdateProfiled()
+    {
+        const CSIRunPhaseStart start;
+        RequestUpdate();
+        requestUpdatePhase_.Record(start);
+    }
+    
+    CSIRunPhase &GetHandleExternalInputPhase() { return handleExternalInputPhase_; }
+    CSIRunPhase &GetRequestUpdatePhase() { return requestUpdatePhase_; }
+    CSIRunPhase &GetFlushIOPhase() { return flushIOPhase_; }
+    
+    void SetRefreshSweepRuns(int refreshSweepRuns) { refreshSweepRuns_ = refreshSweepRuns < 1 ? 1 : refreshSweepRuns; }
+    int GetRefreshSweepRuns() { return refreshSweepRuns_; }
 
     void UpdateCurrentActionContextModifiers()
     {
@@ -2354,7 +3120,7 @@ public:
             return 0;
     }
 
-    const vector<double> GetAccelerationValues(const char * const  widgetClass)
+    const vector<double> &GetAccelerationValues(const char * const  widgetClass)
     {
         if (accelerationValues_.find(widgetClass) != accelerationValues_.end())
             return accelerationValues_[widgetClass];
@@ -2383,6 +3149,9 @@ public:
         for (auto &channelTouch : channelTouches_)
             if (channelTouch.channelNum == channelNum)
             {
+                if (channelTouch.isTouched != isTouched)
+                    g_zoneStateChangeCount++; // touch action contexts
+                
                 channelTouch.isTouched = isTouched;
                 break;
             }
@@ -2403,6 +3172,7 @@ public:
             if (channelToggle.channelNum == channelNum)
             {
                 channelToggle.isToggled = ! channelToggle.isToggled;
+                g_zoneStateChangeCount++; // toggle action contexts
                 break;
             }
     }
@@ -2458,9 +3228,10 @@ public:
         {
             trackColorFeedbackProcessors_.push_back(feedbackProcessor);
 
-            for (int i = 0; i < numChannels_; ++i)
+            if (trackColors_.size() < numChannels_)
             {
-                trackColors_.push_back(rgba_color());
+                trackColors_.resize(numChannels_);
+                hasTrackColorChanged_.resize(numChannels_);
             }
         }
     }
@@ -2587,13 +3358,43 @@ protected:
     int const channelCount_;
     midi_Input *const midiInput_;
     midi_Output *const midiOutput_;
-    WDL_Queue messageQueue_;
+    WDL_Queue messageQueue_; // entries are [size byte][queued time DWORD][message]
     const int maxMesssagesPerRun_;
+    CSIIOTelemetry telemetry_;
+    
+    void CaptureOutput(const unsigned char *data, int size);
     
     void SendMidiSysexMessage(MIDI_event_ex_t *midiMessage)
     {
         if (midiOutput_)
             midiOutput_->SendMsg(midiMessage, -1);
+        
+        telemetry_.messagesOut++;
+        telemetry_.bytesOut += midiMessage->size;
+        
+        if (g_isSessionCaptureActive)
+            CaptureOutput(midiMessage->midi_message, midiMessage->size);
+    }
+    
+    bool PopQueuedSysExMessage(MIDI_event_ex_t *evt)
+    {
+        if (messageQueue_.Available() < 1 + (int)sizeof(DWORD))
+            return false;
+        
+        const unsigned char *msg = (const unsigned char *)messageQueue_.Get();
+        const int msg_len = (int) *msg;
+        if (WDL_NOT_NORMALLY(messageQueue_.Available() < 1 + (int)sizeof(DWORD) + msg_len)) // not enough data in queue, should not happen
+            return false;
+        
+        evt->frame_offset = 0;
+        evt->size = msg_len;
+        memcpy(evt->midi_message, msg + 1 + sizeof(DWORD), msg_len);
+        messageQueue_.Advance(1 + sizeof(DWORD) + msg_len);
+        
+        if (--telemetry_.queueDepth > 0)
+            memcpy(&telemetry_.oldestQueuedTime, (const unsigned char *)messageQueue_.Get() + 1, sizeof(DWORD));
+        
+        return true;
     }
 
 public:
@@ -2613,12 +3414,24 @@ public:
 
     void HandleExternalInput(Midi_ControlSurface *surface);
     
+    CSIIOTelemetry &GetTelemetry() { return telemetry_; }
+    
     void QueueMidiSysExMessage(MIDI_event_ex_t *midiMessage)
     {
-        if (WDL_NOT_NORMALLY(midiMessage->size > 255)) return;
+        if (WDL_NOT_NORMALLY(midiMessage->size > 255))
+        {
+            telemetry_.numDropped++;
+            return;
+        }
 
+        const DWORD now = g_clock.GetMilliseconds();
+        
+        if (telemetry_.queueDepth++ == 0)
+            telemetry_.oldestQueuedTime = now;
+        
         unsigned char size = (unsigned char)midiMessage->size;
         messageQueue_.Add(&size, 1);
+        messageQueue_.Add(&now, sizeof(DWORD));
         messageQueue_.Add(midiMessage->midi_message, midiMessage->size);
     }
 
@@ -2626,57 +3439,54 @@ public:
     {
         if (midiOutput_)
             midiOutput_->Send(first, second, third, -1);
+        
+        telemetry_.messagesOut++;
+        telemetry_.bytesOut += 3;
+        
+        if (g_isSessionCaptureActive)
+        {
+            const unsigned char data[3] = { (unsigned char)first, (unsigned char)second, (unsigned char)third };
+            CaptureOutput(data, 3);
+        }
     }
     
     void Run()
     {
         int numSent = 0;
         
-        while ((maxMesssagesPerRun_ == 0 || numSent < maxMesssagesPerRun_) && messageQueue_.Available() >= 1)
+        struct
+        {
+            MIDI_event_ex_t evt;
+            char data[256];
+        } midiSysExData;
+        
+        while ((maxMesssagesPerRun_ == 0 || numSent < maxMesssagesPerRun_) && PopQueuedSysExMessage(&midiSysExData.evt))
         {
-            const unsigned char *msg = (const unsigned char *)messageQueue_.Get();
-            const int msg_len = (int) *msg;
-            if (WDL_NOT_NORMALLY(messageQueue_.Available() < 1 + msg_len)) // not enough data in queue, should not happen
-                break;
-            
-            struct
-            {
-                MIDI_event_ex_t evt;
-                char data[256];
-            } midiSysExData;
-
-            midiSysExData.evt.frame_offset = 0;
-            midiSysExData.evt.size = msg_len;
-            memcpy(midiSysExData.evt.midi_message, msg + 1, msg_len);
-            messageQueue_.Advance(1 + msg_len);
             SendMidiSysexMessage(&midiSysExData.evt);
             numSent++;
         }
         
         messageQueue_.Compact();
+        
+        telemetry_.OnMidiRunEnd(numSent);
+        telemetry_.numDeferred += telemetry_.queueDepth;
     }
     
     void Flush()
     {
+        struct
+        {
+            MIDI_event_ex_t evt;
+            char data[256];
+        } midiSysExData;
+        
         while (messageQueue_.Available() >= 1)
         {
             Sleep(2);
             
-            const unsigned char *msg = (const unsigned char *)messageQueue_.Get();
-            const int msg_len = (int) *msg;
-            if (WDL_NOT_NORMALLY(messageQueue_.Available() < 1 + msg_len)) // not enough data in queue, should not happen
+            if ( ! PopQueuedSysExMessage(&midiSysExData.evt))
                 break;
             
-            struct
-            {
-                MIDI_event_ex_t evt;
-                char data[256];
-            } midiSysExData;
-
-            midiSysExData.evt.frame_offset = 0;
-            midiSysExData.evt.size = msg_len;
-            memcpy(midiSysExData.evt.midi_message, msg + 1, msg_len);
-            messageQueue_.Advance(1 + msg_len);
             SendMidiSysexMessage(&midiSysExData.evt);
         }
     }
@@ -2747,14 +3557,23 @@ public:
         surfaceIO_->Flush();
     }
     
+    virtual CSIIOTelemetry *GetIOTelemetry() override { return &surfaceIO_->GetTelemetry(); }
+    
     virtual void RequestUpdate() override
     {
-        const DWORD now = GetTickCount();
+        const DWORD now = g_clock.GetMilliseconds();
         const DWORD threshold = (DWORD) (1000 / max(surfaceIO_->surfaceRefreshRate_, 1));
         if ((now - lastRun_) < threshold) return;
         lastRun_=now;
 
-        surfaceIO_->Run();
+        if (g_isRunProfilerEnabled)
+        {
+            const CSIRunPhaseStart start;
+            surfaceIO_->Run();
+            flushIOPhase_.Record(start);
+        }
+        else
+            surfaceIO_->Run();
         
         ControlSurface::RequestUpdate();
     }
@@ -2810,7 +3629,21 @@ protected:
     int maxBundleSize_ = 0; // 0 = no bundles (would only be useful if the destination doesn't support bundles)
     int maxPacketsPerRun_; // 0 = no limit
     int sentPacketCount_= 0; // count of packets sent this Run() slice, after maxPacketsPerRun_ packtees go into packetQueue_
-    WDL_Queue packetQueue_;
+    WDL_Queue packetQueue_; // entries are [size int][queued time DWORD][packet]
+    CSIIOTelemetry telemetry_;
+    
+    void CaptureOutput(const void *p, int sz);
+    
+    void SendPacket(const void *p, int sz)
+    {
+        outSocket_->sendPacket(p, sz);
+        
+        telemetry_.messagesOut++;
+        telemetry_.bytesOut += sz;
+        
+        if (g_isSessionCaptureActive)
+            CaptureOutput(p, sz);
+    }
     
 public:
     OSC_ControlSurfaceIO(CSurfIntegrator *const csi, const char *name, int channelCount, const char *receiveOnPort, const char *transmitToPort, const char *transmitToIpAddress, int maxPacketsPerRun);
@@ -2820,25 +3653,41 @@ public:
 
     const int GetChannelCount() { return channelCount_; }
     
-    virtual void HandleExternalInput(OSC_ControlSurface *surface);
+    void HandleExternalInput(OSC_ControlSurface *surface);
+    virtual void ProcessPacket(OSC_ControlSurface *surface, const char *packetData, int packetSize);
+    
+    CSIIOTelemetry &GetTelemetry() { return telemetry_; }
 
     void QueuePacket(const void *p, int sz)
     {
         if (WDL_NOT_NORMALLY(!outSocket_)) return;
         if (WDL_NOT_NORMALLY(!p || sz < 1)) return;
-        if (WDL_NOT_NORMALLY(packetQueue_.GetSize() > 32*1024*1024)) return; // drop packets after 32MB queued
+        if (WDL_NOT_NORMALLY(packetQueue_.GetSize() > 32*1024*1024)) // drop packets after 32MB queued
+        {
+            if (telemetry_.numDropped++ == 0)
+                LogToConsole(256, "[ERROR] %s: OSC output queue is over 32MB, dropping packets\n", name_.c_str());
+            return;
+        }
         if (maxPacketsPerRun_ != 0 && sentPacketCount_ >= maxPacketsPerRun_)
         {
-            void *wr = packetQueue_.Add(NULL,sz + sizeof(int));
+            void *wr = packetQueue_.Add(NULL,sz + sizeof(int) + sizeof(DWORD));
             if (WDL_NORMALLY(wr != NULL))
             {
+                const DWORD now = g_clock.GetMilliseconds();
+                
+                if (telemetry_.queueDepth == 0)
+                    telemetry_.oldestQueuedTime = now;
+                
+                telemetry_.OnQueued();
+                
                 memcpy(wr, &sz, sizeof(int));
-                memcpy((char *)wr + sizeof(int), p, sz);
+                memcpy((char *)wr + sizeof(int), &now, sizeof(DWORD));
+                memcpy((char *)wr + sizeof(int) + sizeof(DWORD), p, sz);
             }
         }
         else
         {
-            outSocket_->sendPacket(p, sz);
+            SendPacket(p, sz);
             sentPacketCount_++;
         }
     }
@@ -2932,25 +3781,30 @@ public:
     {
         sentPacketCount_ = 0;
         // send any latent packets first
-        while (packetQueue_.GetSize()>=sizeof(int))
+        while (packetQueue_.GetSize() >= (int)(sizeof(int) + sizeof(DWORD)))
         {
             int sza;
             if (maxPacketsPerRun_ != 0 && sentPacketCount_ >= maxPacketsPerRun_) break;
 
             memcpy(&sza, packetQueue_.Get(), sizeof(int));
-            packetQueue_.Advance(sizeof(int));
+            packetQueue_.Advance(sizeof(int) + sizeof(DWORD));
             if (WDL_NOT_NORMALLY(sza < 0 || packetQueue_.GetSize() < sza))
             {
+                telemetry_.numDropped += telemetry_.queueDepth;
+                telemetry_.queueDepth = 0;
                 packetQueue_.Clear();
             }
             else
             {
                 if (WDL_NORMALLY(outSocket_ != NULL))
                 {
-                    outSocket_->sendPacket(packetQueue_.Get(), sza);
+                    SendPacket(packetQueue_.Get(), sza);
                 }
                 packetQueue_.Advance(sza);
                 sentPacketCount_++;
+                
+                if (--telemetry_.queueDepth > 0)
+                    memcpy(&telemetry_.oldestQueuedTime, (const char *)packetQueue_.Get() + sizeof(int), sizeof(DWORD));
             }
         }
         packetQueue_.Compact();
@@ -2959,6 +3813,8 @@ public:
     virtual void Run()
     {
         QueueOSCMessage(NULL); // flush any latent bundles
+        
+        telemetry_.numDeferred += telemetry_.queueDepth;
     }
 };
 
@@ -2968,17 +3824,17 @@ class OSC_X32ControlSurfaceIO :public OSC_ControlSurfaceIO
 {
 protected:
     DWORD X32HeartBeatRefreshInterval_ = 5000;
-    DWORD X32HeartBeatLastRefreshTime_ = GetTickCount() - 30000;
+    DWORD X32HeartBeatLastRefreshTime_ = g_clock.GetMilliseconds() - 30000;
     
 public:
     OSC_X32ControlSurfaceIO(CSurfIntegrator *const csi, const char *name, int channelCount, const char *receiveOnPort, const char *transmitToPort, const char *transmitToIpAddress, int maxPacketsPerRun);
     virtual ~OSC_X32ControlSurfaceIO() {}
 
-    virtual void HandleExternalInput(OSC_ControlSurface *surface) override;
+    virtual void ProcessPacket(OSC_ControlSurface *surface, const char *packetData, int packetSize) override;
 
     void Run() override
     {
-        DWORD currentTime = GetTickCount();
+        DWORD currentTime = g_clock.GetMilliseconds();
 
         if ((currentTime - X32HeartBeatLastRefreshTime_) > X32HeartBeatRefreshInterval_)
         {
@@ -3014,15 +3870,34 @@ public:
 
     virtual void RequestUpdate() override
     {
-        surfaceIO_->BeginRun();
-        ControlSurface::RequestUpdate();
-        surfaceIO_->Run();
+        if (g_isRunProfilerEnabled)
+        {
+            const CSIRunPhaseStart beginRunStart;
+            surfaceIO_->BeginRun();
+            const int duration = (int)(GetProfilerMicroseconds() - beginRunStart.time);
+            const long long numAllocations = GetNumAllocations() - beginRunStart.numAllocations;
+            
+            ControlSurface::RequestUpdate();
+            
+            const CSIRunPhaseStart runStart;
+            surfaceIO_->Run();
+            flushIOPhase_.Record(duration + (int)(GetProfilerMicroseconds() - runStart.time), numAllocations + GetNumAllocations() - runStart.numAllocations);
+        }
+        else
+        {
+            surfaceIO_->BeginRun();
+            ControlSurface::RequestUpdate();
+            surfaceIO_->Run();
+        }
     }
 
     virtual void HandleExternalInput() override
     {
         surfaceIO_->HandleExternalInput(this);
     }
+    
+    virtual CSIIOTelemetry *GetIOTelemetry() override { return &surfaceIO_->GetTelemetry(); }
+    virtual bool GetIsOSC() override { return true; }
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3058,6 +3933,16 @@ protected:
     vector<MediaTrack *> folderParentTracks_;
     vector<MediaTrack *> folderSpillTracks_;
     map<MediaTrack*, vector<MediaTrack*>> folderDictionary_;
+    
+    struct TrackColorCacheEntry
+    {
+        rgba_color color;
+        int tick = -1;
+    };
+    
+    // DAW::GetTrackColor is asked for by every track color widget on every surface, so it is read at most once per track per tick
+    map<MediaTrack *, TrackColorCacheEntry> trackColorCache_;
+    int trackColorCacheTick_ = 0;
  
     vector<unique_ptr<Navigator>> fixedTrackNavigators_;
     vector<unique_ptr<Navigator>> trackNavigators_;
@@ -3126,6 +4011,19 @@ public:
     Navigator *GetSelectedTrackNavigator() { return selectedTrackNavigator_.get(); }
     Navigator *GetFocusedFXNavigator() { return focusedFXNavigator_.get(); }
     
+    rgba_color GetTrackColor(MediaTrack *track)
+    {
+        TrackColorCacheEntry &entry = trackColorCache_[track];
+        
+        if (entry.tick != trackColorCacheTick_)
+        {
+            entry.color = DAW::GetTrackColor(track);
+            entry.tick = trackColorCacheTick_;
+        }
+        
+        return entry.color;
+    }
+    
     bool GetIsTrackVisible(MediaTrack *track)
     {
         return IsTrackVisible(track, followMCP_);
@@ -3289,6 +4187,8 @@ public:
             trackOffset_ = trackOffset;
     }
     
+    int GetTrackOffset() { return trackOffset_; }
+    
     void AdjustTrackBank(int amount)
     {
         if (currentTrackVCAFolderMode_ != 0)
@@ -3782,6 +4682,8 @@ protected:
     unique_ptr<ModifierManager> modifierManager_;
     vector<unique_ptr<ControlSurface>> surfaces_;
     
+    CSIRunPhase rebuildTracksPhase_;
+    
 public:
     Page(CSurfIntegrator *const csi, const char *name, bool followMCP,  bool synchPages, bool isScrollLinkEnabled, bool isScrollSynchEnabled) : csi_(csi), name_(name), trackNavigationManager_(make_unique<TrackNavigationManager>(csi_, this, followMCP, synchPages, isScrollLinkEnabled, isScrollSynchEnabled)), modifierManager_(make_unique<ModifierManager>(csi_, this, (ControlSurface *)NULL)) {}
 
@@ -3931,6 +4833,7 @@ public:
     Navigator *GetMasterTrackNavigator() { return trackNavigationManager_->GetMasterTrackNavigator(); }
     Navigator * GetSelectedTrackNavigator() { return trackNavigationManager_->GetSelectedTrackNavigator(); }
     Navigator * GetFocusedFXNavigator() { return trackNavigationManager_->GetFocusedFXNavigator(); }
+    rgba_color GetTrackColor(MediaTrack *track) { return trackNavigationManager_->GetTrackColor(track); }
     void VCAModeActivated() { trackNavigationManager_->VCAModeActivated(); }
     void VCAModeDeactivated() { trackNavigationManager_->VCAModeDeactivated(); }
     void FolderModeActivated() { trackNavigationManager_->FolderModeActivated(); }
@@ -3950,6 +4853,7 @@ public:
     void ToggleSynchPages() { trackNavigationManager_->ToggleSynchPages(); }
     void ToggleFollowMCP() { trackNavigationManager_->ToggleFollowMCP(); }
     void SetTrackOffset(int offset) { trackNavigationManager_->SetTrackOffset(offset); }
+    int GetTrackOffset() { return trackNavigationManager_->GetTrackOffset(); }
     MediaTrack *GetSelectedTrack() { return trackNavigationManager_->GetSelectedTrack(); }
     void NextInputMonitorMode(MediaTrack *track) { trackNavigationManager_->NextInputMonitorMode(track); }
     const char *GetAutoModeDisplayName(int modeIndex) { return trackNavigationManager_->GetAutoModeDisplayName(modeIndex); }
@@ -3958,80 +4862,50 @@ public:
     const vector<MediaTrack *> &GetSelectedTracks() { return trackNavigationManager_->GetSelectedTracks(); }
     
     
-    /*
-    int repeats = 0;
+    void RebuildTracks()
+    {
+        trackNavigationManager_->RebuildTracks();
+        trackNavigationManager_->RebuildVCASpill();
+        trackNavigationManager_->RebuildFolderTracks();
+        trackNavigationManager_->RebuildSelectedTracks();
+    }
     
     void Run()
     {
-        int start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                
-        repeats++;
-         
-        if (repeats > 50)
+        if (g_isRunProfilerEnabled)
         {
-            repeats = 0;
-            
-            int totalDuration = 0;
-
-            start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-            trackNavigationManager_->RebuildTracks();
-            trackNavigationManager_->RebuildVCASpill();
-            trackNavigationManager_->RebuildFolderTracks();
-            int duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count() - start;
-            totalDuration += duration;
-            ShowDuration("Rebuild Track/VCA/Folder List", duration);
-            
-            for (int i = 0; i < surfaces_.size(); ++i)
-            {
-                start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                surfaces_[i]->HandleExternalInput();
-                duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count() - start;
-                totalDuration += duration;
-                ShowDuration(surfaces_[i]->GetName(), "HandleExternalInput", duration);
-            }
-            
-            for (int i = 0; i < surfaces_.size(); ++i)
-            {
-                start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                surfaces_[i]->RequestUpdate();
-                duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count() - start;
-                totalDuration += duration;
-                ShowDuration(surfaces_[i]->GetName(), "Request Update", duration);
-            }
-            
-            LogToConsole(256, "Total duration = %d\n\n\n", totalDuration);
+            RunProfiled();
+            return;
         }
+        
+        RebuildTracks();
+        
+        for (auto &surface : surfaces_)
+            surface->HandleExternalInput();
+        
+        for (auto &surface : surfaces_)
+            surface->RequestUpdate();
     }
     
-    
-    void ShowDuration(string item, int duration)
-    {
-        LogToConsole(256, "%s - %d microseconds\n", item.c_str(), duration);
-    }
-    
-    void ShowDuration(string surface, string item, int duration)
+    void RunProfiled()
     {
-        LogToConsole(256, "%s - %s - %d microseconds\n", surface.c_str(), item.c_str(), duration);
-    }
-   */
-
-//*
-    void Run()
-    {
-        trackNavigationManager_->RebuildTracks();
-        trackNavigationManager_->RebuildVCASpill();
-        trackNavigationManager_->RebuildFolderTracks();
-        trackNavigationManager_->RebuildSelectedTracks();
+        const CSIRunPhaseStart start;
+        RebuildTracks();
+        rebuildTracksPhase_.Record(start);
         
         for (auto &surface : surfaces_)
-            surface->HandleExternalInput();
+            surface->HandleExternalInputProfiled();
         
         for (auto &surface : surfaces_)
-            surface->RequestUpdate();
+            surface->RequestUpdateProfiled();
     }
-//*/
+    
+    CSIRunPhase &GetRebuildTracksPhase() { return rebuildTracksPhase_; }
 };
 
+static const int s_maxZoneFilesPrefetchedPerRun = 2;
+static const int s_fxStatePollInterval = 15; // Run ticks, fallback in case REAPER does not notify an FX focus or touch change
+
 static const int s_tickCounts_[] = { 250, 235, 220, 205, 190, 175, 160, 145, 130, 115, 100, 90, 80, 70, 60, 50, 45, 40, 35, 30, 25, 20, 20, 20 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -4047,6 +4921,17 @@ private:
     map<const string, unique_ptr<Action>> actions_;
 
     vector<unique_ptr<Page>> pages_;
+    
+    CSIZoneTemplateCache zoneTemplateCache_;
+    CSIZoneManifestCache zoneManifestCache_;
+    CSIFXParamValueCache fxParamValueCache_;
+    CSISessionCapture sessionCapture_;
+    
+    CSIRunPhase runPhase_;
+    
+    map<string, CSIRunHistogram> feedbackLatencyHistograms_; // by widget class, the name of its first FeedbackProcessor
+    int numExpiredLatencyTraces_ = 0;
+    int lastLatencyTraceId_ = 0;
 
     int currentPageIndex_ = 0;
     
@@ -4055,6 +4940,66 @@ private:
     
     ReaProject* currentProject_ = NULL;
     
+    // REAPER can fire hundreds of selection / track list callbacks between two Run ticks (select all, session import),
+    // so they are collapsed here and delivered to the current page at most once each per tick
+    MediaTrack *pendingSelectionTrack_ = NULL;
+    bool isTrackSelectionPending_ = false;
+    bool isTrackListChangePending_ = false;
+    int collapsedTrackEvents_ = 0;
+    
+    void DispatchPendingTrackEvents()
+    {
+        if (collapsedTrackEvents_ > 0 && g_debugLevel >= DEBUG_LEVEL_DEBUG)
+            LogToConsole(256, "[DEBUG] DispatchPendingTrackEvents: collapsed %d track events\n", collapsedTrackEvents_);
+        
+        collapsedTrackEvents_ = 0;
+        
+        if (isTrackListChangePending_)
+        {
+            isTrackListChangePending_ = false;
+            
+            if (pages_.size() > currentPageIndex_ && pages_[currentPageIndex_])
+                pages_[currentPageIndex_]->OnTrackListChange();
+        }
+        
+        if (isTrackSelectionPending_)
+        {
+            isTrackSelectionPending_ = false;
+            
+            MediaTrack *track = pendingSelectionTrack_;
+            pendingSelectionTrack_ = NULL;
+            
+            if (track && DAW::ValidateTrackPtr(track) && pages_.size() > currentPageIndex_ && pages_[currentPageIndex_])
+                pages_[currentPageIndex_]->OnTrackSelection(track);
+        }
+    }
+    
+    // REAPER pushes focused / last touched FX changes through Extended, ZoneManagers compare against
+    // focusedFXChangeCount_ instead of asking REAPER every Run, polling remains only as a low rate fallback
+    int focusedFXChangeCount_ = 0;
+    int fxStatePollCounter_ = 0;
+    
+    bool isLastTouchedFXDirty_ = true;
+    bool hasLastTouchedFX_ = false;
+    int lastTouchedFXTrackNumber_ = 0;
+    int lastTouchedFXSlot_ = 0;
+    int lastTouchedFXParamIndex_ = 0;
+    
+    void OnFXStateChange()
+    {
+        focusedFXChangeCount_++;
+        isLastTouchedFXDirty_ = true;
+    }
+    
+    void PollFXState()
+    {
+        if (++fxStatePollCounter_ >= s_fxStatePollInterval)
+        {
+            fxStatePollCounter_ = 0;
+            OnFXStateChange();
+        }
+    }
+    
     // these are offsets to be passed to projectconfig_var_addr() when needed in order to get the actual pointers
     int timeModeOffs_;
     int timeMode2Offs_;
@@ -4083,6 +5028,27 @@ public:
     ~CSurfIntegrator();
 
     bool isShuttingDown() const { return isShuttingDown_; }
+    
+    CSIZoneTemplateCache &GetZoneTemplateCache() { return zoneTemplateCache_; }
+    CSIZoneManifestCache &GetZoneManifestCache() { return zoneManifestCache_; }
+    CSIFXParamValueCache &GetFXParamValueCache() { return fxParamValueCache_; }
+    
+    int GetFocusedFXChangeCount() { return focusedFXChangeCount_; }
+    
+    bool GetLastTouchedFXParam(int *trackNumber, int *fxSlot, int *paramIndex)
+    {
+        if (isLastTouchedFXDirty_)
+        {
+            isLastTouchedFXDirty_ = false;
+            hasLastTouchedFX_ = ::GetLastTouchedFX(&lastTouchedFXTrackNumber_, &lastTouchedFXSlot_, &lastTouchedFXParamIndex_);
+        }
+        
+        *trackNumber = lastTouchedFXTrackNumber_;
+        *fxSlot = lastTouchedFXSlot_;
+        *paramIndex = lastTouchedFXParamIndex_;
+        
+        return hasLastTouchedFX_;
+    }
 
     virtual int Extended(int call, void *parm1, void *parm2, void *parm3) override;
     const char *GetTypeString() override;
@@ -4107,8 +5073,14 @@ public:
         ResetWidgets();
 
         ShutdownLearn();
+        
+        zoneTemplateCache_.SaveToFile(GetZoneTemplateCacheFilePath());
+        zoneManifestCache_.SaveToFile(GetZoneManifestCacheFilePath());
     }
     
+    string GetZoneTemplateCacheFilePath() { return string(GetResourcePath()) + "/CSI/Cache/ZoneTemplates.bin"; }
+    string GetZoneManifestCacheFilePath() { return string(GetResourcePath()) + "/CSI/Cache/ZoneManifests.bin"; }
+    
     void Init();
 
     double GetFaderMaxDB() { return GetPrivateProfileDouble("slidermaxv"); }
@@ -4181,14 +5153,24 @@ public:
     
     void OnTrackSelection(MediaTrack *track) override
     {
-        if (pages_.size() > currentPageIndex_ && pages_[currentPageIndex_])
-            pages_[currentPageIndex_]->OnTrackSelection(track);
+        if (isTrackSelectionPending_)
+            collapsedTrackEvents_++;
+        
+        // only the final state matters, it is delivered on the next Run
+        pendingSelectionTrack_ = track;
+        isTrackSelectionPending_ = true;
     }
     
     void SetTrackListChange() override
     {
-        if (pages_.size() > currentPageIndex_ && pages_[currentPageIndex_])
-            pages_[currentPageIndex_]->OnTrackListChange();
+        if (isTrackListChangePending_)
+            collapsedTrackEvents_++;
+        
+        isTrackListChangePending_ = true;
+        
+        // track numbers may have shifted under the focused / last touched FX
+        OnFXStateChange();
+        fxParamValueCache_.Clear();
     }
     
     void NextTimeDisplayMode()
@@ -4321,16 +5303,31 @@ public:
     
     const char *GetTCPFXParamName(MediaTrack *track, int fxIndex, int paramIndex, char *buf, int bufsz)
     {
-        buf[0]=0;
-        TrackFX_GetParamName(track, fxIndex, paramIndex, buf, bufsz);
+        snprintf(buf, bufsz, "%s", fxParamValueCache_.GetParamName(track, fxIndex, paramIndex));
         return buf;
     }
         
-    //int repeats = 0;
+    void ToggleRunProfiling();
+    void DumpRunProfile(const char *fileName);
+    void DumpMemoryReport(const char *fileName);
+    
+    void ToggleFeedbackLatencyTracing();
+    
+    CSISessionCapture &GetSessionCapture() { return sessionCapture_; }
+    string GetSessionCaptureFilePath(const char *fileName) { return string(GetResourcePath()) + "/CSI/" + (fileName != NULL && fileName[0] != 0 ? fileName : "Session.csicap"); }
+    
+    void GetIOTelemetryTotals(unsigned int &messagesOut, unsigned int &bytesOut); // over all surface IOs, csi_bench reports the difference per scenario
+    
+    int GetNextLatencyTraceId() { return ++lastLatencyTraceId_ > 0 ? lastLatencyTraceId_ : (lastLatencyTraceId_ = 1); }
+    void RecordFeedbackLatency(const char *widgetClass, int microseconds) { feedbackLatencyHistograms_[widgetClass].Record(microseconds); }
+    void OnLatencyTraceExpired() { numExpiredLatencyTraces_++; }
     
     void Run() override
     {
-        //int start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        const bool isProfiling = g_isRunProfilerEnabled;
+        const CSIRunPhaseStart start(isProfiling);
+        
+        g_clock.Tick();
         
         ReaProject* currentProject = (*EnumProjects)(-1, NULL, 0);
 
@@ -4342,7 +5339,13 @@ public:
         
         if (shouldRun_ && pages_.size() > currentPageIndex_ && pages_[currentPageIndex_]) {
             try {
+                if (g_isSessionCaptureActive)
+                    sessionCapture_.Run();
+                DispatchPendingTrackEvents();
+                PollFXState();
+                fxParamValueCache_.Run();
                 pages_[currentPageIndex_]->Run();
+                zoneTemplateCache_.RunPrefetch(s_maxZoneFilesPrefetchedPerRun);
             } catch (const ReloadPluginException& e) {
                 if (g_debugLevel >= DEBUG_LEVEL_NOTICE) LogToConsole(256, "[NOTICE] RELOADING: : %s\n", e.what());
                 ResetWidgets();
@@ -4352,19 +5355,10 @@ public:
             }
         }
         
-
-        /*
-         repeats++;
-         
-         if (repeats > 50)
-         {
-         repeats = 0;
-         
-         int duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count() - start;
-         
-         LogToConsole(256, "%d microseconds\n", duration);
-         }
-        */
+        if (isProfiling && g_isRunProfilerEnabled) // not when switched on or off during this tick
+            runPhase_.Record(start);
+        
+        g_logQueue.Drain(false);
     }
 };
 
@@ -612,6 +612,279 @@ public:
     }
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class SetRefreshSweepRuns  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "SetRefreshSweepRuns"; }
+
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        context->GetSurface()->SetRefreshSweepRuns(context->GetIntParam());
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ToggleRunProfiler  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "ToggleRunProfiler"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateWidgetValue(g_isRunProfilerEnabled);
+    }
+    
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        context->GetCSI()->ToggleRunProfiling();
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class DumpRunProfiler  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "DumpRunProfiler"; }
+
+    virtual void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateColorValue(0.0);
+    }
+
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        context->GetCSI()->DumpRunProfile(context->GetStringParam()); // no file name dumps to the console
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ToggleLatencyTracing  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "ToggleLatencyTracing"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateWidgetValue(g_isLatencyTracingEnabled);
+    }
+    
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        context->GetCSI()->ToggleFeedbackLatencyTracing();
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ToggleSessionCapture  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "ToggleSessionCapture"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateWidgetValue(context->GetCSI()->GetSessionCapture().GetIsRecording());
+    }
+    
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        CSISessionCapture &sessionCapture = context->GetCSI()->GetSessionCapture();
+        
+        if (sessionCapture.GetIsRecording())
+            sessionCapture.StopRecording();
+        else
+            sessionCapture.StartRecording(context->GetCSI()->GetSessionCaptureFilePath(context->GetStringParam()));
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ReplaySession  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+protected:
+    virtual bool GetIsAsFastAsPossible() { return false; }
+    
+public:
+    virtual const char *GetName() override { return "ReplaySession"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateWidgetValue(context->GetCSI()->GetSessionCapture().GetIsReplaying());
+    }
+    
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        CSISessionCapture &sessionCapture = context->GetCSI()->GetSessionCapture();
+        
+        if (sessionCapture.GetIsReplaying())
+            sessionCapture.StopReplay();
+        else
+            sessionCapture.StartReplay(context->GetCSI()->GetSessionCaptureFilePath(context->GetStringParam()), GetIsAsFastAsPossible());
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ReplaySessionFast  : public ReplaySession
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+protected:
+    virtual bool GetIsAsFastAsPossible() override { return true; }
+    
+public:
+    virtual const char *GetName() override { return "ReplaySessionFast"; }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class DumpMemoryFootprint  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "DumpMemoryFootprint"; }
+
+    virtual void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateColorValue(0.0);
+    }
+
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        context->GetCSI()->DumpMemoryReport(context->GetStringParam()); // no file name dumps to the console
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class IOTelemetryDisplay  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    static string FormatCount(unsigned int count) // keeps big counters readable on 6-7 character displays
+    {
+        char buf[32];
+        
+        if (count >= 10000000)
+            snprintf(buf, sizeof(buf), "%uM", count / 1000000);
+        else if (count >= 10000)
+            snprintf(buf, sizeof(buf), "%uk", count / 1000);
+        else
+            snprintf(buf, sizeof(buf), "%u", count);
+        
+        return buf;
+    }
+    
+public:
+    virtual const char *GetName() override { return "IOTelemetryDisplay"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        CSIIOTelemetry *telemetry = context->GetSurface()->GetIOTelemetry();
+        
+        if (telemetry == NULL)
+        {
+            context->ClearWidget();
+            return;
+        }
+        
+        const string counter = context->GetStringParam();
+        string value;
+        
+        if (counter == "MessagesIn") value = FormatCount(telemetry->messagesIn);
+        else if (counter == "BytesIn") value = FormatCount(telemetry->bytesIn);
+        else if (counter == "MessagesOut") value = FormatCount(telemetry->messagesOut);
+        else if (counter == "BytesOut") value = FormatCount(telemetry->bytesOut);
+        else if (counter == "Queued") value = FormatCount(telemetry->numQueued);
+        else if (counter == "Deferred") value = FormatCount(telemetry->numDeferred);
+        else if (counter == "Dropped") value = FormatCount(telemetry->numDropped);
+        else if (counter == "QueueDepth") value = FormatCount(telemetry->queueDepth);
+        else if (counter == "PeakQueueDepth") value = FormatCount(telemetry->peakQueueDepth);
+        else if (counter == "OldestQueuedAge") value = FormatCount(telemetry->GetOldestQueuedAge(g_clock.GetMilliseconds())) + "ms";
+        else
+            value = FormatCount(telemetry->messagesIn) + "/" + FormatCount(telemetry->messagesOut) + " Q" + FormatCount(telemetry->queueDepth) + " X" + FormatCount(telemetry->numDropped);
+        
+        context->UpdateWidgetValue(value.c_str());
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ToggleIOTelemetryOSC  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "ToggleIOTelemetryOSC"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateWidgetValue(context->GetSurface()->GetIsSendingIOTelemetry());
+    }
+    
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        context->GetSurface()->ToggleIOTelemetryOSC(context->GetStringParam()); // ToggleIOTelemetryOSC [address:]port, 127.0.0.1:9100 by default
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ResetIOTelemetry  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "ResetIOTelemetry"; }
+
+    virtual void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateColorValue(0.0);
+    }
+
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        for (auto &surface : context->GetSurface()->GetPage()->GetSurfaces())
+            if (CSIIOTelemetry *telemetry = surface->GetIOTelemetry())
+                telemetry->Reset();
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class ToggleLogToFile  : public Action
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    virtual const char *GetName() override { return "ToggleLogToFile"; }
+
+    void RequestUpdate(ActionContext *context) override
+    {
+        context->UpdateWidgetValue(g_logQueue.GetIsLoggingToFile());
+    }
+    
+    void Do(ActionContext *context, double value) override
+    {
+        if (value == ActionContext::BUTTON_RELEASE_MESSAGE_VALUE) return;
+        
+        g_logQueue.SetIsLoggingToFile( ! g_logQueue.GetIsLoggingToFile()); // CSI/CSI.log instead of the console
+    }
+};
+
 class ToggleEnableFocusedFXMapping  : public Action
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 {
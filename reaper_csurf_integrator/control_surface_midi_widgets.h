@@ -1049,6 +1049,8 @@ public:
         }
     }
     
+    virtual bool IsSingleTrackColor() override { return true; }
+    
     virtual void ForceUpdateTrackColors() override
     {
         if (preventUpdateTrackColors_)
@@ -1084,7 +1086,7 @@ public:
     
     virtual void RunDeferredActions() override
     {
-        if (shouldSetToZero_ && (GetTickCount() - timeZeroValueReceived_) > 250)
+        if (shouldSetToZero_ && (g_clock.GetMilliseconds() - timeZeroValueReceived_) > 250)
         {
             ForceMidiMessage(midiFeedbackMessage1_.midi_message[0], 0x00, 0x00);
             shouldSetToZero_ = false;
@@ -1096,7 +1098,7 @@ public:
         if (value == 0.0)
         {
             shouldSetToZero_ = true;
-            timeZeroValueReceived_ = GetTickCount();
+            timeZeroValueReceived_ = g_clock.GetMilliseconds();
             return;
         }
         else
@@ -1139,7 +1141,7 @@ public:
     
     virtual void RunDeferredActions() override
     {
-        if (shouldSetToZero_ && (GetTickCount() - timeZeroValueReceived_) > 250)
+        if (shouldSetToZero_ && (g_clock.GetMilliseconds() - timeZeroValueReceived_) > 250)
         {
             ForceMidiMessage(midiFeedbackMessage1_.midi_message[0], midiFeedbackMessage1_.midi_message[1], 0x00);
             ForceMidiMessage(midiFeedbackMessage2_.midi_message[0], midiFeedbackMessage2_.midi_message[1], 0x00);
@@ -1153,7 +1155,7 @@ public:
         if (value == 0.0)
         {
             shouldSetToZero_ = true;
-            timeZeroValueReceived_ = GetTickCount();
+            timeZeroValueReceived_ = g_clock.GetMilliseconds();
             return;
         }
         else
@@ -2882,7 +2884,7 @@ public:
     virtual void SetValue(const PropertyList &properties, double value) override
     {        
 //#ifndef timeGetTime
-        DWORD now = GetTickCount();
+        DWORD now = g_clock.GetMilliseconds();
 //#else
         //DWORD now = timeGetTime();
 //#endif
@@ -68,9 +68,92 @@ enum DebugLevel {
     DEBUG_LEVEL_DEBUG = 4
 };
 
+enum CSILogRecordType { CSILogSkip, CSILogText, CSILogMidiIn, CSILogMidiOut, CSILogMidiSysExOut };
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSILogQueue
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    // messages are written as records into a fixed ring and turned into text once per Run, the file takes
+    // everything, at most s_maxConsoleBytesPerRun_ go to REAPER's console and the rest waits in the ring,
+    // when the ring is full new messages are dropped and counted
+    struct Record
+    {
+        int size; // payload bytes
+        short type; // CSILogRecordType
+        bool isInFile; // already written through by Commit
+        time_t time; // when the message was logged, not when it was drained
+    };
+    
+    static const int s_capacity_ = 1 << 20;
+    static const int s_maxRecordSize_ = s_capacity_ / 4;
+    static const int s_maxConsoleBytesPerRun_ = 16384;
+    static const long s_maxFileSize_ = 4 * 1024 * 1024; // CSI.log is rotated to CSI.1.log past this
+    
+    alignas(8) char buffer_[s_capacity_];
+    long long writePosition_ = 0;
+    long long fileReadPosition_ = 0;
+    long long consoleReadPosition_ = 0; // trails fileReadPosition_ while the console limit holds text back
+    int reservedOffset_ = -1;
+    
+    bool isDraining_ = false; // a CSurfIntegrator drains from Run, without one messages are written straight through
+    bool isLoggingToConsole_ = true;
+#ifdef _DEBUG
+    bool isLoggingToFile_ = true;
+#else
+    bool isLoggingToFile_ = false;
+#endif
+    FILE *file_ = NULL;
+    long fileSize_ = 0;
+    
+    unsigned int numRecords_ = 0;
+    unsigned int numDropped_ = 0;
+    unsigned int numDroppedReported_ = 0;
+    
+    string text_; // reused by Drain
+    string fileText_;
+    time_t lastTime_ = 0;
+    char timeStr_[32] = "";
+    
+    static int GetRecordSize(int payloadSize) { return (int)((sizeof(Record) + payloadSize + 7) & ~7); }
+    
+    void FormatRecord(const Record *record, string &text);
+    void AppendTimestamp(time_t time, string &text);
+    void WriteToFile(const char *text, int size);
+    
+public:
+    char *Reserve(int &maxPayloadSize); // clamps maxPayloadSize, NULL when the message is dropped
+    void Commit(CSILogRecordType type, int payloadSize);
+    void LogMidi(CSILogRecordType type, const char *surfaceName, const unsigned char *bytes, int size);
+    
+    void Drain(bool isFlushing);
+    
+    void SetIsDraining(bool isDraining) { isDraining_ = isDraining; }
+    bool GetIsDraining() { return isDraining_; }
+    void SetIsLoggingToFile(bool isLoggingToFile);
+    bool GetIsLoggingToFile() { return isLoggingToFile_; }
+    unsigned int GetNumRecords() { return numRecords_; }
+    unsigned int GetNumDropped() { return numDropped_; }
+};
+
+extern CSILogQueue g_logQueue;
+
 template <typename... Args>
 static void LogToConsole(int size, const char* format, Args... args)
 {
+    if (g_logQueue.GetIsDraining())
+    {
+        int capacity = size;
+        
+        if (char *payload = g_logQueue.Reserve(capacity))
+        {
+            int length = snprintf(payload, capacity, format, args...);
+            g_logQueue.Commit(CSILogText, length < 0 ? 0 : (length < capacity ? length : capacity - 1));
+        }
+        return;
+    }
+    
     vector<char> buffer(size);
     snprintf(buffer.data(), buffer.size(), format, args...);
     ShowConsoleMsg(buffer.data());
@@ -0,0 +1,496 @@
+//
+//  csi_bench.cpp
+//  csi_bench
+//
+//  Runs the CSI core headless against the stub REAPER API in csi_stub_reaper.cpp: a synthetic project,
+//  an MCU style MIDI surface on in memory devices and an OSC surface on loopback, driven through
+//  a fixed set of scenarios, reporting what each tick costs
+//
+
+#include "csi_stub_reaper.h"
+
+struct CSIBenchOptions
+{
+    int numTracks = 64;
+    int numFXPerTrack = 2;
+    int numParamsPerFX = 16;
+    int numTicksPerScenario = 300;
+    int oscPort = 18000; // CSI receives on this port and transmits to the next one
+    bool isOSCEnabled = true;
+    bool isPlaying = false;
+    bool isCheckingAllocations = false; // exit code says whether the steady state Idle scenario allocated after warm-up
+};
+
+enum CSIBenchScenarioType
+{
+    BenchScenario_Idle,
+    BenchScenario_BankScroll,
+    BenchScenario_FaderRide,
+    BenchScenario_FXFocusChurn,
+    BenchScenario_PageSwitch,
+};
+
+struct CSIBenchScenario
+{
+    const char *name;
+    CSIBenchScenarioType type;
+};
+
+// nothing changes in the project or on the surfaces, so once warmed up a tick must not allocate
+static const CSIBenchScenarioType s_steadyStateScenario = BenchScenario_Idle;
+
+static const int s_exitAllocationCheckFailed = 1;
+static const int s_exitAllocationCountingUnavailable = 77; // reported as skipped by ctest
+
+static const CSIBenchScenario s_benchScenarios[] =
+{
+    { "Idle",           BenchScenario_Idle },
+    { "BankScroll",     BenchScenario_BankScroll },
+    { "FaderRide",      BenchScenario_FaderRide },
+    { "FXFocusChurn",   BenchScenario_FXFocusChurn },
+    { "PageSwitch",     BenchScenario_PageSwitch },
+};
+
+static const int s_numBenchChannels = 8;
+static const int s_benchMidiPort = 0;
+
+// MCU note numbers
+static const int s_benchMuteNote = 0x10;
+static const int s_benchSelectNote = 0x18;
+static const int s_benchBankLeftNote = 0x2e;
+static const int s_benchBankRightNote = 0x2f;
+static const int s_benchPageNote = 0x36;
+static const int s_benchRotaryCC = 0x10;
+static const int s_benchRotaryRingCC = 0x30;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Synthetic CSI folder
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void WriteBenchFile(const filesystem::path &path, const string &contents)
+{
+    filesystem::create_directories(path.parent_path());
+
+    ofstream file(path);
+    file << contents;
+}
+
+static string HexByte(int value)
+{
+    char buf[8];
+    snprintf(buf, sizeof(buf), "%02x", value & 0xff);
+    return buf;
+}
+
+static void WriteBenchCSIFolder(const filesystem::path &csiFolder, const CSIBenchOptions &options)
+{
+    string ini = "Version=7.0\n\n";
+
+    ini += "SurfaceType=MIDI SurfaceName=BenchMCU SurfaceChannelCount=8 MidiInput=" + to_string(s_benchMidiPort) + " MidiOutput=" + to_string(s_benchMidiPort) + " MIDISurfaceRefreshRate=15 MaxMIDIMesssagesPerRun=0\n";
+
+    if (options.isOSCEnabled)
+        ini += "SurfaceType=OSC SurfaceName=BenchOSC SurfaceChannelCount=8 ReceiveOnPort=" + to_string(options.oscPort) + " TransmitToPort=" + to_string(options.oscPort + 1) + " TransmitToIPAddress=127.0.0.1 MaxPacketsPerRun=0\n";
+
+    for (const char *pageName : { "Home", "Mix" })
+    {
+        ini += string("\nPageName=") + pageName + " PageFollowsMCP=No SynchPages=No ScrollLink=No ScrollSynch=No\n";
+        ini += "Surface=BenchMCU SurfaceFolder=BenchMCU StartChannel=0 ZoneFolder=BenchMCU FXZoneFolder=BenchMCU\n";
+
+        if (options.isOSCEnabled)
+            ini += "Surface=BenchOSC SurfaceFolder=BenchOSC StartChannel=0 ZoneFolder=BenchOSC FXZoneFolder=BenchOSC\n";
+    }
+
+    WriteBenchFile(csiFolder / "CSI.ini", ini);
+
+    // MIDI surface
+    string surface;
+
+    for (int i = 0; i < s_numBenchChannels; ++i)
+    {
+        const string channel = to_string(i + 1);
+        const string bend = HexByte(0xe0 + i);
+        const string select = HexByte(s_benchSelectNote + i);
+        const string mute = HexByte(s_benchMuteNote + i);
+
+        surface += "Widget Fader" + channel + "\n\tFader14Bit " + bend + " 7f 7f\n\tFB_Fader14Bit " + bend + " 7f 7f\nWidgetEnd\n\n";
+        surface += "Widget Select" + channel + "\n\tPress 90 " + select + " 7f 90 " + select + " 00\n\tFB_TwoState 90 " + select + " 7f 90 " + select + " 00\nWidgetEnd\n\n";
+        surface += "Widget Mute" + channel + "\n\tPress 90 " + mute + " 7f 90 " + mute + " 00\n\tFB_TwoState 90 " + mute + " 7f 90 " + mute + " 00\nWidgetEnd\n\n";
+        surface += "Widget Rotary" + channel + "\n\tEncoder b0 " + HexByte(s_benchRotaryCC + i) + " 7f\n\tFB_Encoder b0 " + HexByte(s_benchRotaryRingCC + i) + " 7f\nWidgetEnd\n\n";
+        surface += "Widget DisplayUpper" + channel + "\n\tFB_MCUDisplayUpper " + to_string(i) + "\nWidgetEnd\n\n";
+        surface += "Widget DisplayLower" + channel + "\n\tFB_MCUDisplayLower " + to_string(i) + "\nWidgetEnd\n\n";
+        surface += "Widget VUMeter" + channel + "\n\tFB_MCUVUMeter " + to_string(i) + "\nWidgetEnd\n\n";
+    }
+
+    surface += "Widget BankLeft\n\tPress 90 " + HexByte(s_benchBankLeftNote) + " 7f 90 " + HexByte(s_benchBankLeftNote) + " 00\nWidgetEnd\n\n";
+    surface += "Widget BankRight\n\tPress 90 " + HexByte(s_benchBankRightNote) + " 7f 90 " + HexByte(s_benchBankRightNote) + " 00\nWidgetEnd\n\n";
+    surface += "Widget PageButton\n\tPress 90 " + HexByte(s_benchPageNote) + " 7f 90 " + HexByte(s_benchPageNote) + " 00\nWidgetEnd\n";
+
+    WriteBenchFile(csiFolder / "Surfaces" / "BenchMCU" / "Surface.txt", surface);
+
+    WriteBenchFile(csiFolder / "Surfaces" / "BenchMCU" / "Zones" / "Home.zon",
+                   "Zone \"Home\"\n"
+                   "\tIncludedZones\n"
+                   "\t\t\"Track\"\n"
+                   "\tIncludedZonesEnd\n"
+                   "\tBankLeft\tBank Track -1\n"
+                   "\tBankRight\tBank Track 1\n"
+                   "\tPageButton\tNextPage\n"
+                   "ZoneEnd\n");
+
+    WriteBenchFile(csiFolder / "Surfaces" / "BenchMCU" / "Zones" / "Track.zon",
+                   "Zone \"Track\"\n"
+                   "\tFader|\t\tTrackVolume\n"
+                   "\tSelect|\t\tTrackUniqueSelect\n"
+                   "\tMute|\t\tTrackMute\n"
+                   "\tRotary|\t\tTrackPan\n"
+                   "\tDisplayUpper|\tTrackNameDisplay\n"
+                   "\tDisplayLower|\tTrackVolumeDisplay\n"
+                   "\tVUMeter|\tTrackOutputMeterAverageLR\n"
+                   "ZoneEnd\n");
+
+    for (int i = 0; i < s_numStubFXNames; ++i)
+    {
+        string fxZone = string("Zone \"") + s_stubFXNames[i] + "\" \"" + (i == 0 ? "BenchEQ" : "BenchComp") + "\"\n";
+
+        for (int j = 0; j < s_numBenchChannels && j < options.numParamsPerFX; ++j)
+        {
+            const string channel = to_string(j + 1);
+            const string param = to_string(j);
+
+            fxZone += "\tRotary" + channel + "\tFXParam " + param + "\n";
+            fxZone += "\tDisplayUpper" + channel + "\tFXParamNameDisplay " + param + "\n";
+            fxZone += "\tDisplayLower" + channel + "\tFXParamValueDisplay " + param + "\n";
+        }
+
+        fxZone += "ZoneEnd\n";
+
+        WriteBenchFile(csiFolder / "Surfaces" / "BenchMCU" / "FXZones" / (string(i == 0 ? "BenchEQ" : "BenchComp") + ".zon"), fxZone);
+    }
+
+    // OSC surface
+    if ( ! options.isOSCEnabled)
+        return;
+
+    surface = "";
+
+    for (int i = 0; i < s_numBenchChannels; ++i)
+    {
+        const string channel = to_string(i + 1);
+
+        for (const char *widget : { "Fader", "Mute", "Select" })
+            surface += string("Widget ") + widget + channel + "\n\tControl /" + widget + channel + "\n\tFB_Processor /" + widget + channel + "\nWidgetEnd\n\n";
+
+        for (const char *widget : { "TrackName", "TrackVolume" })
+            surface += string("Widget ") + widget + channel + "\n\tFB_Processor /" + widget + channel + "\nWidgetEnd\n\n";
+    }
+
+    WriteBenchFile(csiFolder / "Surfaces" / "BenchOSC" / "Surface.txt", surface);
+
+    WriteBenchFile(csiFolder / "Surfaces" / "BenchOSC" / "Zones" / "Home.zon",
+                   "Zone \"Home\"\n"
+                   "\tIncludedZones\n"
+                   "\t\t\"Track\"\n"
+                   "\tIncludedZonesEnd\n"
+                   "ZoneEnd\n");
+
+    WriteBenchFile(csiFolder / "Surfaces" / "BenchOSC" / "Zones" / "Track.zon",
+                   "Zone \"Track\"\n"
+                   "\tFader|\t\tTrackVolume\n"
+                   "\tMute|\t\tTrackMute\n"
+                   "\tSelect|\t\tTrackUniqueSelect\n"
+                   "\tTrackName|\tTrackNameDisplay\n"
+                   "\tTrackVolume|\tTrackVolumeDisplay\n"
+                   "ZoneEnd\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scenarios, each tick queues what the surfaces send before that Run
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void QueueNotePress(int tick, int note)
+{
+    if (tick % 4 == 0)
+        CSIStubReaper::QueueMidiInput(s_benchMidiPort, 0x90, note, 0x7f);
+    else if (tick % 4 == 1)
+        CSIStubReaper::QueueMidiInput(s_benchMidiPort, 0x90, note, 0x00);
+}
+
+static void SendOSCFloat(oscpkt::UdpSocket *socket, const char *address, float value)
+{
+    if (socket == NULL || ! socket->isOk())
+        return;
+
+    oscpkt::Message message(address);
+    message.pushFloat(value);
+
+    oscpkt::PacketWriter writer;
+    writer.addMessage(message);
+
+    socket->sendPacket(writer.packetData(), writer.packetSize());
+}
+
+static void DriveScenario(CSIBenchScenarioType type, int tick, oscpkt::UdpSocket *oscSocket)
+{
+    switch (type)
+    {
+        case BenchScenario_Idle:
+            break;
+
+        case BenchScenario_BankScroll:
+            // a page of banks right, then back left
+            QueueNotePress(tick, (tick / 32) % 2 == 0 ? s_benchBankRightNote : s_benchBankLeftNote);
+            break;
+
+        case BenchScenario_FaderRide:
+        {
+            // one fader at a time follows a slow sine, on the MIDI surface and the OSC surface
+            const int channel = (tick / 30) % s_numBenchChannels;
+            const double position = 0.5 + 0.45 * sin(tick * 0.2);
+            const int value = (int)(position * 16383.0);
+
+            CSIStubReaper::QueueMidiInput(s_benchMidiPort, 0xe0 + channel, value & 0x7f, (value >> 7) & 0x7f);
+
+            char address[32];
+            snprintf(address, sizeof(address), "/Fader%d", channel + 1);
+            SendOSCFloat(oscSocket, address, (float)position);
+            break;
+        }
+
+        case BenchScenario_FXFocusChurn:
+            // selecting a track focuses one of its FX, which maps its FX zone over the rotaries and displays
+            QueueNotePress(tick, s_benchSelectNote + (tick / 4) % s_numBenchChannels);
+            break;
+
+        case BenchScenario_PageSwitch:
+            if (tick % 8 < 2)
+                QueueNotePress(tick, s_benchPageNote);
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Measurement
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct CSIBenchResult
+{
+    const char *name = "";
+    CSIBenchScenarioType type = BenchScenario_Idle;
+    int numTicks = 0;
+    long long totalMicroseconds = 0;
+    CSIRunHistogram durations;
+    long long numAllocations = 0; // after warm-up
+    unsigned int numMessagesOut = 0;
+    unsigned int numBytesOut = 0;
+    long long numAPICalls = 0;
+};
+
+static void RunScenario(CSurfIntegrator *csi, const CSIBenchScenario &scenario, const CSIBenchOptions &options, oscpkt::UdpSocket *oscSocket, CSIBenchResult &result)
+{
+    result.name = scenario.name;
+    result.type = scenario.type;
+    result.numTicks = options.numTicksPerScenario;
+
+    // the first quarter of the ticks lets caches, pools and queues reach their working size
+    const int numWarmUpTicks = options.numTicksPerScenario / 4;
+
+    unsigned int messagesOutStart = 0;
+    unsigned int bytesOutStart = 0;
+    csi->GetIOTelemetryTotals(messagesOutStart, bytesOutStart);
+
+    const long long apiCallsStart = CSIStubReaper::GetNumAPICalls();
+
+    for (int tick = 0; tick < options.numTicksPerScenario; ++tick)
+    {
+        DriveScenario(scenario.type, tick, oscSocket);
+        CSIStubReaper::Tick();
+
+        const long long startMicroseconds = GetProfilerMicroseconds();
+        const long long startAllocations = GetNumAllocations();
+
+        csi->Run();
+
+        const int duration = (int)(GetProfilerMicroseconds() - startMicroseconds);
+
+        result.durations.Record(duration);
+        result.totalMicroseconds += duration;
+
+        if (tick >= numWarmUpTicks)
+            result.numAllocations += GetNumAllocations() - startAllocations;
+    }
+
+    unsigned int messagesOut = 0;
+    unsigned int bytesOut = 0;
+    csi->GetIOTelemetryTotals(messagesOut, bytesOut);
+
+    result.numMessagesOut = messagesOut - messagesOutStart;
+    result.numBytesOut = bytesOut - bytesOutStart;
+    result.numAPICalls = CSIStubReaper::GetNumAPICalls() - apiCallsStart;
+}
+
+static void PrintResults(const vector<CSIBenchResult> &results, const CSIBenchOptions &options, bool isCountingAllocations)
+{
+    printf("csi_bench: %d tracks, %d FX per track, %d params per FX, %d ticks per scenario, transport %s, OSC %s\n\n",
+           options.numTracks, options.numFXPerTrack, options.numParamsPerFX, options.numTicksPerScenario, options.isPlaying ? "playing" : "stopped", options.isOSCEnabled ? "on" : "off");
+
+    printf("%-14s %7s %11s %8s %8s %8s %9s %10s %10s %12s\n", "Scenario", "Ticks", "Ticks/sec", "Avg us", "p95 us", "Max us", "Msgs out", "Bytes out", "API/tick", "Allocs/tick");
+
+    for (const CSIBenchResult &result : results)
+    {
+        CSIRunHistogram durations = result.durations;
+
+        const int numMeasuredTicks = result.numTicks - result.numTicks / 4;
+
+        char allocations[32];
+
+        if (isCountingAllocations)
+            snprintf(allocations, sizeof(allocations), "%.2f", numMeasuredTicks > 0 ? (double)result.numAllocations / numMeasuredTicks : 0.0);
+        else
+            snprintf(allocations, sizeof(allocations), "n/a");
+
+        printf("%-14s %7d %11.0f %8.1f %8d %8d %9u %10u %10.1f %12s\n",
+               result.name,
+               result.numTicks,
+               result.totalMicroseconds > 0 ? result.numTicks * 1000000.0 / result.totalMicroseconds : 0.0,
+               result.numTicks > 0 ? (double)result.totalMicroseconds / result.numTicks : 0.0,
+               durations.GetPercentile(95.0),
+               durations.GetMax(),
+               result.numMessagesOut,
+               result.numBytesOut,
+               result.numTicks > 0 ? (double)result.numAPICalls / result.numTicks : 0.0,
+               allocations);
+    }
+}
+
+// returns the exit code for --check-allocations
+static int PrintSteadyStateAllocations(const vector<CSIBenchResult> &results, bool isCountingAllocations)
+{
+    if ( ! isCountingAllocations)
+    {
+        printf("\nSteady state: allocation counting unavailable\n");
+        return s_exitAllocationCountingUnavailable;
+    }
+
+    for (const CSIBenchResult &result : results)
+    {
+        if (result.type != s_steadyStateScenario)
+            continue;
+
+        if (result.numAllocations == 0)
+        {
+            printf("\nSteady state: PASSED, %s made no allocations after warm-up\n", result.name);
+            return 0;
+        }
+
+        printf("\nSteady state: FAILED, %s made %lld allocations after warm-up\n", result.name, result.numAllocations);
+        return s_exitAllocationCheckFailed;
+    }
+
+    return 0;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr, "usage: csi_bench [--tracks N] [--fx N] [--params N] [--ticks N] [--osc-port N] [--no-osc] [--playing] [--check-allocations]\n");
+}
+
+static bool ParseOptions(int argc, char *argv[], CSIBenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+
+        if (arg == "--no-osc")
+            options.isOSCEnabled = false;
+        else if (arg == "--playing")
+            options.isPlaying = true;
+        else if (arg == "--check-allocations")
+            options.isCheckingAllocations = true;
+        else if (i + 1 < argc && arg == "--tracks")
+            options.numTracks = atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--fx")
+            options.numFXPerTrack = atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--params")
+            options.numParamsPerFX = atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--ticks")
+            options.numTicksPerScenario = atoi(argv[++i]);
+        else if (i + 1 < argc && arg == "--osc-port")
+            options.oscPort = atoi(argv[++i]);
+        else
+            return false;
+    }
+
+    return options.numTracks > 0 && options.numFXPerTrack >= 0 && options.numParamsPerFX >= 0 && options.numTicksPerScenario > 0 && options.oscPort > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    CSIBenchOptions options;
+
+    if ( ! ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    // an executable's operator new replaces the library's for every call, but check it really is the one being called
+    const bool isCountingAllocations = GetIsAllocationCountingAvailable();
+
+#ifdef CSI_ALLOCATION_COUNTING
+    if ( ! isCountingAllocations)
+        printf("csi_bench: allocation counting unavailable\n");
+#endif
+
+    const filesystem::path resourceFolder = filesystem::temp_directory_path() / ("csi_bench_" + to_string(GetProfilerMicroseconds()));
+
+    WriteBenchCSIFolder(resourceFolder / "CSI", options);
+
+    CSIStubReaper::Install(resourceFolder.string().c_str(), options.numTracks, options.numFXPerTrack, options.numParamsPerFX);
+    CSIStubReaper::SetIsPlaying(options.isPlaying);
+
+    g_clock.SetIsSimulated(true);
+
+    int exitCode = 0;
+
+    {
+        CSurfIntegrator *csi = new CSurfIntegrator();
+        CSIStubReaper::SetControlSurface(csi);
+
+        // the first Run sees a new project and asks REAPER to refresh the surfaces, which runs Init
+        csi->Run();
+
+        oscpkt::UdpSocket oscSocket;
+
+        if (options.isOSCEnabled)
+            oscSocket.connectTo("127.0.0.1", options.oscPort);
+
+        unsigned int messagesOut = 0;
+        unsigned int bytesOut = 0;
+        csi->GetIOTelemetryTotals(messagesOut, bytesOut);
+
+        if (CSIStubReaper::GetNumMessageBoxes() > 0 || messagesOut == 0)
+        {
+            fprintf(stderr, "csi_bench: CSI did not come up on the synthetic CSI folder in %s\n", resourceFolder.string().c_str());
+            exitCode = 1;
+        }
+        else
+        {
+            vector<CSIBenchResult> results(sizeof(s_benchScenarios) / sizeof(s_benchScenarios[0]));
+
+            for (int i = 0; i < (int)results.size(); ++i)
+                RunScenario(csi, s_benchScenarios[i], options, options.isOSCEnabled ? &oscSocket : NULL, results[i]);
+
+            PrintResults(results, options, isCountingAllocations);
+
+            const int allocationsExitCode = PrintSteadyStateAllocations(results, isCountingAllocations);
+
+            if (options.isCheckingAllocations)
+                exitCode = allocationsExitCode;
+        }
+
+        CSIStubReaper::SetControlSurface(NULL);
+        delete csi;
+    }
+
+    error_code ec;
+    filesystem::remove_all(resourceFolder, ec);
+
+    return exitCode;
+}
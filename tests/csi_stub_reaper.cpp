@@ -0,0 +1,1218 @@
+//
+//  csi_stub_reaper.cpp
+//  csi_bench
+//
+//
+
+#define REAPERAPI_IMPLEMENT
+#define REAPERAPI_DECL
+
+#define REAPERAPI_WANT_TrackFX_GetParamNormalized
+#define REAPERAPI_WANT_TrackFX_SetParamNormalized
+#include "reaper_plugin_functions.h"
+
+#include "csi_stub_reaper.h"
+
+#include <filesystem>
+
+extern void localize_init(void * (*GetFunc)(const char *name));
+
+REAPER_PLUGIN_HINSTANCE g_hInst;
+HWND g_hwnd;
+reaper_plugin_info_t *g_reaper_plugin_info;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct StubFX
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    const char *name = "";
+    vector<double> params; // normalized
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct StubTrack
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+    int trackNumber = 0; // 0 = master
+    string name;
+    int color = 0;
+    double volume = 1.0;
+    double pan = 0.0;
+    double width = 1.0;
+    double dualPanL = -1.0;
+    double dualPanR = 1.0;
+    bool isMuted = false;
+    bool isSoloed = false;
+    bool isSelected = false;
+    bool isRecordArmed = false;
+    bool isPhaseInverted = false;
+    int autoMode = 0;
+    int recordMonitor = 0;
+    int recordMonitorItems = 0;
+    vector<StubFX> fx;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class StubMidiEventList : public MIDI_eventlist
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    vector<MIDI_event_t> events_; // short messages only, that is all a surface sends CSI here
+
+public:
+    virtual ~StubMidiEventList() {}
+
+    void AddItem(MIDI_event_t *evt) override
+    {
+        if (evt->size <= (int)sizeof(evt->midi_message))
+            events_.push_back(*evt);
+    }
+
+    MIDI_event_t *EnumItems(int *bpos) override { return *bpos < (int)events_.size() ? &events_[(*bpos)++] : NULL; }
+    void DeleteItem(int bpos) override { if (bpos >= 0 && bpos < (int)events_.size()) events_.erase(events_.begin() + bpos); }
+    int GetSize() override { return (int)(events_.size() * sizeof(MIDI_event_t)); }
+    void Empty() override { events_.clear(); }
+
+    void Swap(StubMidiEventList &other) { events_.swap(other.events_); } // keeps both capacities, so a steady input rate does not allocate
+};
+
+class StubMidiInput;
+
+static map<int, StubMidiInput *> s_midiInputs; // by port, CSI owns and deletes them
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class StubMidiInput : public midi_Input
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+private:
+    int port_;
+    StubMidiEventList pending_;
+    StubMidiEventList readBuf_;
+
+public:
+    StubMidiInput(int port) : port_(port) { s_midiInputs[port_] = this; }
+    virtual ~StubMidiInput() { s_midiInputs.erase(port_); }
+
+    void start() override {}
+    void stop() override {}
+
+    void SwapBufs(unsigned int timestamp) override
+    {
+        readBuf_.Empty();
+        readBuf_.Swap(pending_);
+    }
+
+    MIDI_eventlist *GetReadBuf() override { return &readBuf_; }
+
+    void Queue(unsigned char status, unsigned char data1, unsigned char data2)
+    {
+        MIDI_event_t evt = { 0, 3, { status, data1, data2, 0 } };
+        pending_.AddItem(&evt);
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class StubMidiOutput : public midi_Output
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    // CSI counts what it sends in its own I/O telemetry, the device just swallows it
+    void SendMsg(MIDI_event_t *msg, int frame_offset) override {}
+    void Send(unsigned char status, unsigned char d1, unsigned char d2, int frame_offset) override {}
+};
+
+static string s_resourcePath;
+static vector<unique_ptr<StubTrack>> s_tracks; // [0] is the master
+static char s_project; // only its address is used, as the one open project
+static IReaperControlSurface *s_surface = NULL;
+
+static bool s_isPlaying = false;
+static int s_frame = 0;
+
+static MediaTrack *s_focusedFXTrack = NULL;
+static int s_focusedFXSlot = -1;
+
+static bool s_hasLastTouchedFX = false;
+static int s_lastTouchedFXTrackNumber = 0;
+static int s_lastTouchedFXSlot = 0;
+static int s_lastTouchedFXParam = 0;
+
+static long long s_numAPICalls = 0;
+static int s_numMessageBoxes = 0;
+
+static StubTrack *ToStubTrack(MediaTrack *track) { return (StubTrack *)track; }
+static MediaTrack *ToMediaTrack(StubTrack *track) { return (MediaTrack *)track; }
+
+static StubTrack *GetValidStubTrack(void *pointer)
+{
+    for (auto &track : s_tracks)
+        if (track.get() == pointer)
+            return track.get();
+
+    return NULL;
+}
+
+static StubFX *GetStubFX(MediaTrack *track, int fx)
+{
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL || fx < 0 || fx >= (int)stubTrack->fx.size())
+        return NULL;
+
+    return &stubTrack->fx[fx];
+}
+
+static double *GetStubFXParam(MediaTrack *track, int fx, int param)
+{
+    StubFX *stubFX = GetStubFX(track, fx);
+
+    if (stubFX == NULL || param < 0 || param >= (int)stubFX->params.size())
+        return NULL;
+
+    return &stubFX->params[param];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// REAPER calling back into the surface
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void NotifySelection(MediaTrack *selectedTrack)
+{
+    if (s_surface == NULL)
+        return;
+
+    s_surface->OnTrackSelection(selectedTrack);
+
+    // the synthetic user opens an FX on each track they select, so FX focus follows selection,
+    // alternating between the FX types from one track to the next
+    StubTrack *stubTrack = ToStubTrack(selectedTrack);
+
+    if (stubTrack->fx.size() > 0)
+    {
+        s_focusedFXTrack = selectedTrack;
+        s_focusedFXSlot = stubTrack->trackNumber % (int)stubTrack->fx.size();
+        s_surface->Extended(CSURF_EXT_SETFOCUSEDFX, selectedTrack, NULL, &s_focusedFXSlot);
+    }
+}
+
+static void SetSelection(StubTrack *stubTrack, bool isSelected)
+{
+    if (stubTrack->isSelected == isSelected)
+        return;
+
+    stubTrack->isSelected = isSelected;
+
+    if (s_surface != NULL)
+        s_surface->SetSurfaceSelected(ToMediaTrack(stubTrack), isSelected);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Project and tracks
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static ReaProject *StubEnumProjects(int idx, char *projfnOutOptional, int projfnOutOptional_sz)
+{
+    s_numAPICalls++;
+
+    if (projfnOutOptional != NULL && projfnOutOptional_sz > 0)
+        projfnOutOptional[0] = 0;
+
+    return idx <= 0 ? (ReaProject *)&s_project : NULL;
+}
+
+static const char *StubGetResourcePath()
+{
+    s_numAPICalls++;
+    return s_resourcePath.c_str();
+}
+
+static int StubRecursiveCreateDirectory(const char *path, size_t ignored)
+{
+    s_numAPICalls++;
+
+    error_code ec;
+    filesystem::create_directories(path, ec);
+
+    return ec ? 0 : 1;
+}
+
+static void StubShowConsoleMsg(const char *msg)
+{
+    s_numAPICalls++;
+    fputs(msg, stderr);
+}
+
+static bool StubValidatePtr(void *pointer, const char *ctypename)
+{
+    s_numAPICalls++;
+    return ! strcmp(ctypename, "MediaTrack*") && GetValidStubTrack(pointer) != NULL;
+}
+
+static int StubGetNumTracks()
+{
+    s_numAPICalls++;
+    return (int)s_tracks.size() - 1;
+}
+
+static int StubCSurf_NumTracks(bool mcpView)
+{
+    s_numAPICalls++;
+    return (int)s_tracks.size() - 1;
+}
+
+static MediaTrack *StubGetTrack(ReaProject *proj, int trackidx)
+{
+    s_numAPICalls++;
+    return trackidx >= 0 && trackidx + 1 < (int)s_tracks.size() ? ToMediaTrack(s_tracks[trackidx + 1].get()) : NULL;
+}
+
+static MediaTrack *StubGetMasterTrack(ReaProject *proj)
+{
+    s_numAPICalls++;
+    return ToMediaTrack(s_tracks[0].get());
+}
+
+static MediaTrack *StubCSurf_TrackFromID(int idx, bool mcpView)
+{
+    s_numAPICalls++;
+    return idx >= 0 && idx < (int)s_tracks.size() ? ToMediaTrack(s_tracks[idx].get()) : NULL;
+}
+
+static int StubCSurf_TrackToID(MediaTrack *track, bool mcpView)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+    return stubTrack != NULL ? stubTrack->trackNumber : -1;
+}
+
+static bool StubIsTrackVisible(MediaTrack *track, bool mixer)
+{
+    s_numAPICalls++;
+    return true;
+}
+
+static bool StubGetTrackName(MediaTrack *track, char *bufOut, int bufOut_sz)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+    snprintf(bufOut, bufOut_sz, "%s", stubTrack != NULL ? stubTrack->name.c_str() : "");
+
+    return stubTrack != NULL;
+}
+
+static int StubGetTrackColor(MediaTrack *track)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+    return stubTrack != NULL ? stubTrack->color : 0;
+}
+
+static void StubColorFromNative(int col, int *rOut, int *gOut, int *bOut)
+{
+    s_numAPICalls++;
+
+    *rOut = col & 0xff;
+    *gOut = (col >> 8) & 0xff;
+    *bOut = (col >> 16) & 0xff;
+}
+
+static int StubColorToNative(int r, int g, int b)
+{
+    s_numAPICalls++;
+    return (r & 0xff) | ((g & 0xff) << 8) | ((b & 0xff) << 16);
+}
+
+static double StubGetMediaTrackInfo_Value(MediaTrack *tr, const char *parmname)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(tr);
+
+    if (stubTrack == NULL)
+        return 0.0;
+
+    if ( ! strcmp(parmname, "D_VOL"))           return stubTrack->volume;
+    if ( ! strcmp(parmname, "D_PAN"))           return stubTrack->pan;
+    if ( ! strcmp(parmname, "D_WIDTH"))         return stubTrack->width;
+    if ( ! strcmp(parmname, "D_DUALPANL"))      return stubTrack->dualPanL;
+    if ( ! strcmp(parmname, "D_DUALPANR"))      return stubTrack->dualPanR;
+    if ( ! strcmp(parmname, "B_MUTE"))          return stubTrack->isMuted;
+    if ( ! strcmp(parmname, "I_SOLO"))          return stubTrack->isSoloed;
+    if ( ! strcmp(parmname, "I_SELECTED"))      return stubTrack->isSelected;
+    if ( ! strcmp(parmname, "I_RECARM"))        return stubTrack->isRecordArmed;
+    if ( ! strcmp(parmname, "B_PHASE"))         return stubTrack->isPhaseInverted;
+    if ( ! strcmp(parmname, "I_AUTOMODE"))      return stubTrack->autoMode;
+    if ( ! strcmp(parmname, "I_RECMON"))        return stubTrack->recordMonitor;
+    if ( ! strcmp(parmname, "I_RECMONITEMS"))   return stubTrack->recordMonitorItems;
+    if ( ! strcmp(parmname, "I_FXEN"))          return 1.0;
+    if ( ! strcmp(parmname, "IP_TRACKNUMBER"))  return stubTrack->trackNumber == 0 ? -1.0 : stubTrack->trackNumber;
+
+    return 0.0; // I_FOLDERDEPTH, I_RECINPUT, the synthetic project has no folders and no inputs
+}
+
+static void *StubGetSetMediaTrackInfo(MediaTrack *tr, const char *parmname, void *setNewValue)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(tr);
+
+    if (stubTrack == NULL)
+        return NULL;
+
+    if ( ! strcmp(parmname, "P_NAME"))
+    {
+        if (setNewValue != NULL)
+            stubTrack->name = (const char *)setNewValue;
+
+        return (void *)stubTrack->name.c_str();
+    }
+
+    void *value = NULL;
+    size_t size = 0;
+
+    if ( ! strcmp(parmname, "I_CUSTOMCOLOR"))       { value = &stubTrack->color; size = sizeof(int); }
+    else if ( ! strcmp(parmname, "I_AUTOMODE"))     { value = &stubTrack->autoMode; size = sizeof(int); }
+    else if ( ! strcmp(parmname, "I_RECMON"))       { value = &stubTrack->recordMonitor; size = sizeof(int); }
+    else if ( ! strcmp(parmname, "I_RECMONITEMS"))  { value = &stubTrack->recordMonitorItems; size = sizeof(int); }
+    else if ( ! strcmp(parmname, "B_PHASE"))        { value = &stubTrack->isPhaseInverted; size = sizeof(bool); }
+    else if ( ! strcmp(parmname, "D_DUALPANL"))     { value = &stubTrack->dualPanL; size = sizeof(double); }
+    else if ( ! strcmp(parmname, "D_DUALPANR"))     { value = &stubTrack->dualPanR; size = sizeof(double); }
+
+    if (value != NULL && setNewValue != NULL)
+        memcpy(value, setNewValue, size);
+
+    return value;
+}
+
+static unsigned int StubGetSetTrackGroupMembership(MediaTrack *tr, const char *groupname, unsigned int setmask, unsigned int setvalue)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static int StubGetTrackNumSends(MediaTrack *tr, int category)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static double StubGetTrackSendInfo_Value(MediaTrack *tr, int category, int sendidx, const char *parmname)
+{
+    s_numAPICalls++;
+    return 0.0;
+}
+
+static int StubCountTrackMediaItems(MediaTrack *track)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Selection
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static int StubCountSelectedTracks2(ReaProject *proj, bool wantmaster)
+{
+    s_numAPICalls++;
+
+    int count = 0;
+
+    for (int i = wantmaster ? 0 : 1; i < (int)s_tracks.size(); ++i)
+        if (s_tracks[i]->isSelected)
+            count++;
+
+    return count;
+}
+
+static int StubCountSelectedTracks(ReaProject *proj)
+{
+    s_numAPICalls--; // counted once, by the call below
+    return StubCountSelectedTracks2(proj, false);
+}
+
+static MediaTrack *StubGetSelectedTrack2(ReaProject *proj, int seltrackidx, bool wantmaster)
+{
+    s_numAPICalls++;
+
+    for (int i = wantmaster ? 0 : 1; i < (int)s_tracks.size(); ++i)
+        if (s_tracks[i]->isSelected && seltrackidx-- == 0)
+            return ToMediaTrack(s_tracks[i].get());
+
+    return NULL;
+}
+
+static MediaTrack *StubGetSelectedTrack(ReaProject *proj, int seltrackidx)
+{
+    s_numAPICalls--; // counted once, by the call below
+    return StubGetSelectedTrack2(proj, seltrackidx, false);
+}
+
+static void StubSetOnlyTrackSelected(MediaTrack *track)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL)
+        return;
+
+    for (auto &other : s_tracks)
+        SetSelection(other.get(), other.get() == stubTrack);
+
+    NotifySelection(track);
+}
+
+static void StubSetTrackSelected(MediaTrack *track, bool selected)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL || stubTrack->isSelected == selected)
+        return;
+
+    SetSelection(stubTrack, selected);
+
+    if (selected)
+        NotifySelection(track);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Mixer, CSurf_On* change the project, CSurf_SetSurface* tell every surface but the one that made the change
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool StubGetTrackUIVolPan(MediaTrack *track, double *volumeOut, double *panOut)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL)
+        return false;
+
+    *volumeOut = stubTrack->volume;
+    *panOut = stubTrack->pan;
+
+    return true;
+}
+
+static bool StubGetTrackUIPan(MediaTrack *track, double *pan1Out, double *pan2Out, int *panmodeOut)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL)
+        return false;
+
+    *pan1Out = stubTrack->pan;
+    *pan2Out = stubTrack->width;
+    *panmodeOut = 3; // stereo balance
+
+    return true;
+}
+
+static bool StubGetTrackUIMute(MediaTrack *track, bool *muteOut)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL)
+        return false;
+
+    *muteOut = stubTrack->isMuted;
+
+    return true;
+}
+
+static double StubCSurf_OnVolumeChange(MediaTrack *trackid, double volume, bool relative)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return volume;
+
+    stubTrack->volume = max(0.0, relative ? stubTrack->volume + volume : volume);
+
+    return stubTrack->volume;
+}
+
+static double StubCSurf_OnPanChange(MediaTrack *trackid, double pan, bool relative)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return pan;
+
+    stubTrack->pan = max(-1.0, min(1.0, relative ? stubTrack->pan + pan : pan));
+
+    return stubTrack->pan;
+}
+
+static double StubCSurf_OnWidthChange(MediaTrack *trackid, double width, bool relative)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return width;
+
+    stubTrack->width = max(-1.0, min(1.0, relative ? stubTrack->width + width : width));
+
+    return stubTrack->width;
+}
+
+static bool StubCSurf_OnMuteChange(MediaTrack *trackid, int mute)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return false;
+
+    stubTrack->isMuted = mute < 0 ? ! stubTrack->isMuted : mute != 0;
+
+    return stubTrack->isMuted;
+}
+
+static bool StubCSurf_OnSoloChange(MediaTrack *trackid, int solo)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return false;
+
+    stubTrack->isSoloed = solo < 0 ? ! stubTrack->isSoloed : solo != 0;
+
+    return stubTrack->isSoloed;
+}
+
+static bool StubCSurf_OnRecArmChange(MediaTrack *trackid, int recarm)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return false;
+
+    stubTrack->isRecordArmed = recarm < 0 ? ! stubTrack->isRecordArmed : recarm != 0;
+
+    return stubTrack->isRecordArmed;
+}
+
+static bool StubCSurf_OnSelectedChange(MediaTrack *trackid, int selected)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(trackid);
+
+    if (stubTrack == NULL)
+        return false;
+
+    stubTrack->isSelected = selected < 0 ? ! stubTrack->isSelected : selected != 0;
+
+    return stubTrack->isSelected;
+}
+
+static void StubCSurf_SetSurfaceVolume(MediaTrack *trackid, double volume, IReaperControlSurface *ignoresurf)
+{
+    s_numAPICalls++;
+
+    if (s_surface != NULL && s_surface != ignoresurf)
+        s_surface->SetSurfaceVolume(trackid, volume);
+}
+
+static void StubCSurf_SetSurfacePan(MediaTrack *trackid, double pan, IReaperControlSurface *ignoresurf)
+{
+    s_numAPICalls++;
+
+    if (s_surface != NULL && s_surface != ignoresurf)
+        s_surface->SetSurfacePan(trackid, pan);
+}
+
+static void StubCSurf_SetSurfaceMute(MediaTrack *trackid, bool mute, IReaperControlSurface *ignoresurf)
+{
+    s_numAPICalls++;
+
+    if (s_surface != NULL && s_surface != ignoresurf)
+        s_surface->SetSurfaceMute(trackid, mute);
+}
+
+static void StubCSurf_SetSurfaceSolo(MediaTrack *trackid, bool solo, IReaperControlSurface *ignoresurf)
+{
+    s_numAPICalls++;
+
+    if (s_surface != NULL && s_surface != ignoresurf)
+        s_surface->SetSurfaceSolo(trackid, solo);
+}
+
+static void StubCSurf_SetSurfaceRecArm(MediaTrack *trackid, bool recarm, IReaperControlSurface *ignoresurf)
+{
+    s_numAPICalls++;
+
+    if (s_surface != NULL && s_surface != ignoresurf)
+        s_surface->SetSurfaceRecArm(trackid, recarm);
+}
+
+static void StubCSurf_SetSurfaceSelected(MediaTrack *trackid, bool selected, IReaperControlSurface *ignoresurf)
+{
+    s_numAPICalls++;
+
+    if (s_surface != NULL && s_surface != ignoresurf)
+        s_surface->SetSurfaceSelected(trackid, selected);
+}
+
+static bool StubAnyTrackSolo(ReaProject *proj)
+{
+    s_numAPICalls++;
+
+    for (auto &track : s_tracks)
+        if (track->isSoloed)
+            return true;
+
+    return false;
+}
+
+static int StubGetMasterMuteSoloFlags()
+{
+    s_numAPICalls++;
+    return (s_tracks[0]->isMuted ? 1 : 0) | (s_tracks[0]->isSoloed ? 2 : 0);
+}
+
+static int StubGetGlobalAutomationOverride()
+{
+    s_numAPICalls++;
+    return -1;
+}
+
+static double StubTrack_GetPeakInfo(MediaTrack *track, int channel)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+
+    if (stubTrack == NULL || ! s_isPlaying)
+        return 0.0;
+
+    return 0.5 + 0.4 * sin(s_frame * 0.3 + stubTrack->trackNumber + channel);
+}
+
+static double StubTrack_GetPeakHoldDB(MediaTrack *track, int channel, bool clear)
+{
+    s_numAPICalls++;
+    return s_isPlaying ? -6.0 : -150.0;
+}
+
+static double StubSLIDER2DB(double y)
+{
+    s_numAPICalls++;
+    return y * 162.0 / 1000.0 - 150.0; // linear in dB from -150 to +12, close enough for CSI to round trip through
+}
+
+static double StubDB2SLIDER(double x)
+{
+    s_numAPICalls++;
+    return max(0.0, min(1000.0, (x + 150.0) * 1000.0 / 162.0));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transport and time
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static int StubGetPlayState()
+{
+    s_numAPICalls++;
+    return s_isPlaying ? 1 : 0;
+}
+
+static double StubGetPlayPosition()
+{
+    s_numAPICalls++;
+    return s_isPlaying ? s_frame * s_simulatedRunInterval / 1000000.0 : 0.0;
+}
+
+static double StubGetCursorPosition()
+{
+    s_numAPICalls++;
+    return 0.0;
+}
+
+static double StubGetProjectLength(ReaProject *proj)
+{
+    s_numAPICalls++;
+    return 0.0;
+}
+
+static int StubGetSetRepeatEx(ReaProject *proj, int val)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static void StubFormat_timestr_pos(double tpos, char *buf, int buf_sz, int modeoverride)
+{
+    s_numAPICalls++;
+    snprintf(buf, buf_sz, "%.3f", tpos);
+}
+
+static double StubTimeMap2_timeToBeats(ReaProject *proj, double tpos, int *measuresOutOptional, int *cmlOutOptional, double *fullbeatsOutOptional, int *cdenomOutOptional)
+{
+    s_numAPICalls++;
+
+    // 120 bpm in 4/4
+    const double beats = tpos * 2.0;
+
+    if (measuresOutOptional) *measuresOutOptional = (int)(beats / 4.0);
+    if (cmlOutOptional) *cmlOutOptional = 4;
+    if (fullbeatsOutOptional) *fullbeatsOutOptional = beats;
+    if (cdenomOutOptional) *cdenomOutOptional = 4;
+
+    return fmod(beats, 4.0);
+}
+
+static int StubProjectconfig_var_getoffs(const char *name, int *szOut)
+{
+    s_numAPICalls++;
+
+    if (szOut != NULL)
+        *szOut = 0; // CSI falls back when a project setting is not there
+
+    return 0;
+}
+
+static void *StubProjectconfig_var_addr(ReaProject *proj, int idx)
+{
+    s_numAPICalls++;
+    return NULL;
+}
+
+static void *StubGet_config_var(const char *name, int *szOut)
+{
+    s_numAPICalls++;
+
+    if (szOut != NULL)
+        *szOut = 0;
+
+    return NULL;
+}
+
+static int StubGetToggleCommandState(int command_id)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static int StubNamedCommandLookup(const char *command_name)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static int StubIsProjectDirty(ReaProject *proj)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static const char *StubUndo_CanUndo2(ReaProject *proj)
+{
+    s_numAPICalls++;
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FX
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static int StubTrackFX_GetCount(MediaTrack *track)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(track);
+    return stubTrack != NULL ? (int)stubTrack->fx.size() : 0;
+}
+
+static bool StubTrackFX_GetFXName(MediaTrack *track, int fx, char *bufOut, int bufOut_sz)
+{
+    s_numAPICalls++;
+
+    StubFX *stubFX = GetStubFX(track, fx);
+    snprintf(bufOut, bufOut_sz, "%s", stubFX != NULL ? stubFX->name : "");
+
+    return stubFX != NULL;
+}
+
+static int StubTrackFX_GetNumParams(MediaTrack *track, int fx)
+{
+    s_numAPICalls++;
+
+    StubFX *stubFX = GetStubFX(track, fx);
+    return stubFX != NULL ? (int)stubFX->params.size() : 0;
+}
+
+static bool StubTrackFX_GetParamName(MediaTrack *track, int fx, int param, char *bufOut, int bufOut_sz)
+{
+    s_numAPICalls++;
+
+    if (GetStubFXParam(track, fx, param) == NULL)
+    {
+        snprintf(bufOut, bufOut_sz, "%s", "");
+        return false;
+    }
+
+    snprintf(bufOut, bufOut_sz, "Param %d", param + 1);
+
+    return true;
+}
+
+static double StubTrackFX_GetParamNormalized(MediaTrack *track, int fx, int param)
+{
+    s_numAPICalls++;
+
+    double *value = GetStubFXParam(track, fx, param);
+    return value != NULL ? *value : 0.0;
+}
+
+static double StubTrackFX_GetParam(MediaTrack *track, int fx, int param, double *minvalOut, double *maxvalOut)
+{
+    s_numAPICalls++;
+
+    *minvalOut = 0.0;
+    *maxvalOut = 1.0;
+
+    double *value = GetStubFXParam(track, fx, param);
+    return value != NULL ? *value : 0.0;
+}
+
+static bool StubTrackFX_SetParamNormalized(MediaTrack *track, int fx, int param, double value)
+{
+    s_numAPICalls++;
+
+    double *paramValue = GetStubFXParam(track, fx, param);
+
+    if (paramValue == NULL)
+        return false;
+
+    *paramValue = max(0.0, min(1.0, value));
+
+    s_hasLastTouchedFX = true;
+    s_lastTouchedFXTrackNumber = ToStubTrack(track)->trackNumber;
+    s_lastTouchedFXSlot = fx;
+    s_lastTouchedFXParam = param;
+
+    if (s_surface != NULL)
+    {
+        int fxAndParam = (fx << 16) | param;
+        s_surface->Extended(CSURF_EXT_SETFXPARAM, track, &fxAndParam, paramValue);
+    }
+
+    return true;
+}
+
+static bool StubTrackFX_GetFormattedParamValue(MediaTrack *track, int fx, int param, char *bufOut, int bufOut_sz)
+{
+    s_numAPICalls++;
+
+    double *value = GetStubFXParam(track, fx, param);
+    snprintf(bufOut, bufOut_sz, "%.1f", value != NULL ? *value * 100.0 : 0.0);
+
+    return value != NULL;
+}
+
+static bool StubTrackFX_EndParamEdit(MediaTrack *track, int fx, int param)
+{
+    s_numAPICalls++;
+    return GetStubFXParam(track, fx, param) != NULL;
+}
+
+static bool StubTrackFX_GetEnabled(MediaTrack *track, int fx)
+{
+    s_numAPICalls++;
+    return GetStubFX(track, fx) != NULL;
+}
+
+static bool StubTrackFX_GetOffline(MediaTrack *track, int fx)
+{
+    s_numAPICalls++;
+    return false;
+}
+
+static bool StubTrackFX_GetNamedConfigParm(MediaTrack *track, int fx, const char *parmname, char *bufOutNeedBig, int bufOutNeedBig_sz)
+{
+    s_numAPICalls++;
+    return false;
+}
+
+static int StubCountTCPFXParms(ReaProject *project, MediaTrack *track)
+{
+    s_numAPICalls++;
+    return 0;
+}
+
+static bool StubGetTCPFXParm(ReaProject *project, MediaTrack *track, int index, int *fxindexOut, int *parmidxOut)
+{
+    s_numAPICalls++;
+    return false;
+}
+
+static bool StubGetLastTouchedFX(int *tracknumberOut, int *fxnumberOut, int *paramnumberOut)
+{
+    s_numAPICalls++;
+
+    *tracknumberOut = s_lastTouchedFXTrackNumber;
+    *fxnumberOut = s_lastTouchedFXSlot;
+    *paramnumberOut = s_lastTouchedFXParam;
+
+    return s_hasLastTouchedFX;
+}
+
+static bool StubGetTouchedOrFocusedFX(int mode, int *trackidxOut, int *itemidxOut, int *takeidxOut, int *fxidxOut, int *parmOut)
+{
+    s_numAPICalls++;
+
+    StubTrack *stubTrack = GetValidStubTrack(s_focusedFXTrack);
+
+    if (mode != 1 || stubTrack == NULL || s_focusedFXSlot < 0)
+        return false;
+
+    *trackidxOut = stubTrack->trackNumber - 1; // -1 = master
+    *itemidxOut = -1;
+    *takeidxOut = -1;
+    *fxidxOut = s_focusedFXSlot;
+    *parmOut = 0;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// MIDI devices
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static midi_Input *StubCreateMIDIInput(int dev)
+{
+    s_numAPICalls++;
+    return s_midiInputs.find(dev) == s_midiInputs.end() ? new StubMidiInput(dev) : NULL;
+}
+
+static midi_Output *StubCreateMIDIOutput(int dev, bool streamMode, int *msoffset100)
+{
+    s_numAPICalls++;
+    return new StubMidiOutput();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SWELL
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static DWORD StubGetTickCount()
+{
+    return (DWORD)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void StubSleep(int ms) {}
+
+static int StubMessageBox(HWND hwndParent, const char *text, const char *caption, int type)
+{
+    s_numMessageBoxes++;
+    fprintf(stderr, "MessageBox %s: %s\n", caption, text);
+
+    return IDOK;
+}
+
+static LRESULT StubSendMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    // Control surface: Refresh all surfaces, REAPER answers it by resetting every surface
+    if (msg == WM_COMMAND && wParam == REAPER__CONTROL_SURFACE_REFRESH_ALL_SURFACES && s_surface != NULL)
+        s_surface->Extended(CSURF_EXT_RESET, NULL, NULL, NULL);
+
+    return 0;
+}
+
+static const char *StubLocalizeFunc(const char *str, const char *subctx, int flags) { return str; }
+
+static void *StubGetFunc(const char *name)
+{
+    if ( ! strcmp(name, "__localizeFunc"))
+        return (void *)&StubLocalizeFunc;
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CSIStubReaper
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CSIStubReaper::Install(const char *resourcePath, int numTracks, int numFXPerTrack, int numParamsPerFX)
+{
+    s_resourcePath = resourcePath;
+
+    s_tracks.clear();
+
+    for (int i = 0; i <= numTracks; ++i)
+    {
+        s_tracks.push_back(make_unique<StubTrack>());
+        StubTrack &track = *s_tracks.back();
+
+        track.trackNumber = i;
+        track.name = i == 0 ? "MASTER" : "Track " + to_string(i);
+        track.color = i == 0 ? 0 : (0x1000000 | StubColorToNative(40 + (i * 53) % 200, 40 + (i * 97) % 200, 40 + (i * 29) % 200));
+
+        for (int j = 0; i > 0 && j < numFXPerTrack; ++j)
+        {
+            track.fx.push_back(StubFX());
+            track.fx.back().name = s_stubFXNames[j % s_numStubFXNames];
+
+            for (int k = 0; k < numParamsPerFX; ++k)
+                track.fx.back().params.push_back((k % 10) / 10.0);
+        }
+    }
+
+    s_numAPICalls = 0;
+
+    EnumProjects = StubEnumProjects;
+    GetResourcePath = StubGetResourcePath;
+    RecursiveCreateDirectory = StubRecursiveCreateDirectory;
+    ShowConsoleMsg = StubShowConsoleMsg;
+    ValidatePtr = StubValidatePtr;
+
+    ::GetNumTracks = StubGetNumTracks;
+    CSurf_NumTracks = StubCSurf_NumTracks;
+    ::GetTrack = StubGetTrack;
+    GetMasterTrack = StubGetMasterTrack;
+    CSurf_TrackFromID = StubCSurf_TrackFromID;
+    CSurf_TrackToID = StubCSurf_TrackToID;
+    IsTrackVisible = StubIsTrackVisible;
+    GetTrackName = StubGetTrackName;
+    GetTrackColor = StubGetTrackColor;
+    ColorFromNative = StubColorFromNative;
+    ColorToNative = StubColorToNative;
+    GetMediaTrackInfo_Value = StubGetMediaTrackInfo_Value;
+    GetSetMediaTrackInfo = StubGetSetMediaTrackInfo;
+    GetSetTrackGroupMembership = StubGetSetTrackGroupMembership;
+    GetSetTrackGroupMembershipHigh = StubGetSetTrackGroupMembership;
+    GetTrackNumSends = StubGetTrackNumSends;
+    GetTrackSendInfo_Value = StubGetTrackSendInfo_Value;
+    CountTrackMediaItems = StubCountTrackMediaItems;
+
+    CountSelectedTracks = StubCountSelectedTracks;
+    CountSelectedTracks2 = StubCountSelectedTracks2;
+    GetSelectedTrack = StubGetSelectedTrack;
+    GetSelectedTrack2 = StubGetSelectedTrack2;
+    SetOnlyTrackSelected = StubSetOnlyTrackSelected;
+    SetTrackSelected = StubSetTrackSelected;
+
+    GetTrackUIVolPan = StubGetTrackUIVolPan;
+    GetTrackUIPan = StubGetTrackUIPan;
+    GetTrackUIMute = StubGetTrackUIMute;
+    CSurf_OnVolumeChange = StubCSurf_OnVolumeChange;
+    CSurf_OnPanChange = StubCSurf_OnPanChange;
+    CSurf_OnWidthChange = StubCSurf_OnWidthChange;
+    CSurf_OnMuteChange = StubCSurf_OnMuteChange;
+    CSurf_OnSoloChange = StubCSurf_OnSoloChange;
+    CSurf_OnRecArmChange = StubCSurf_OnRecArmChange;
+    CSurf_OnSelectedChange = StubCSurf_OnSelectedChange;
+    CSurf_SetSurfaceVolume = StubCSurf_SetSurfaceVolume;
+    CSurf_SetSurfacePan = StubCSurf_SetSurfacePan;
+    CSurf_SetSurfaceMute = StubCSurf_SetSurfaceMute;
+    CSurf_SetSurfaceSolo = StubCSurf_SetSurfaceSolo;
+    CSurf_SetSurfaceRecArm = StubCSurf_SetSurfaceRecArm;
+    CSurf_SetSurfaceSelected = StubCSurf_SetSurfaceSelected;
+    AnyTrackSolo = StubAnyTrackSolo;
+    GetMasterMuteSoloFlags = StubGetMasterMuteSoloFlags;
+    GetGlobalAutomationOverride = StubGetGlobalAutomationOverride;
+    Track_GetPeakInfo = StubTrack_GetPeakInfo;
+    Track_GetPeakHoldDB = StubTrack_GetPeakHoldDB;
+    SLIDER2DB = StubSLIDER2DB;
+    DB2SLIDER = StubDB2SLIDER;
+
+    GetPlayState = StubGetPlayState;
+    GetPlayPosition = StubGetPlayPosition;
+    GetCursorPosition = StubGetCursorPosition;
+    GetProjectLength = StubGetProjectLength;
+    GetSetRepeatEx = StubGetSetRepeatEx;
+    format_timestr_pos = StubFormat_timestr_pos;
+    TimeMap2_timeToBeats = StubTimeMap2_timeToBeats;
+    projectconfig_var_getoffs = StubProjectconfig_var_getoffs;
+    projectconfig_var_addr = StubProjectconfig_var_addr;
+    get_config_var = StubGet_config_var;
+    GetToggleCommandState = StubGetToggleCommandState;
+    NamedCommandLookup = StubNamedCommandLookup;
+    IsProjectDirty = StubIsProjectDirty;
+    Undo_CanUndo2 = StubUndo_CanUndo2;
+    Undo_CanRedo2 = StubUndo_CanUndo2;
+
+    TrackFX_GetCount = StubTrackFX_GetCount;
+    TrackFX_GetFXName = StubTrackFX_GetFXName;
+    TrackFX_GetNumParams = StubTrackFX_GetNumParams;
+    TrackFX_GetParamName = StubTrackFX_GetParamName;
+    TrackFX_GetParamNormalized = StubTrackFX_GetParamNormalized;
+    TrackFX_GetParam = StubTrackFX_GetParam;
+    TrackFX_SetParamNormalized = StubTrackFX_SetParamNormalized;
+    TrackFX_GetFormattedParamValue = StubTrackFX_GetFormattedParamValue;
+    TrackFX_EndParamEdit = StubTrackFX_EndParamEdit;
+    TrackFX_GetEnabled = StubTrackFX_GetEnabled;
+    TrackFX_GetOffline = StubTrackFX_GetOffline;
+    TrackFX_GetNamedConfigParm = StubTrackFX_GetNamedConfigParm;
+    CountTCPFXParms = StubCountTCPFXParms;
+    GetTCPFXParm = StubGetTCPFXParm;
+    GetLastTouchedFX = StubGetLastTouchedFX;
+    GetTouchedOrFocusedFX = StubGetTouchedOrFocusedFX;
+
+    CreateMIDIInput = StubCreateMIDIInput;
+    CreateMIDIOutput = StubCreateMIDIOutput;
+
+    GetTickCount = StubGetTickCount;
+    Sleep = StubSleep;
+    MessageBox = StubMessageBox;
+    SendMessage = StubSendMessage;
+
+    localize_init(StubGetFunc);
+}
+
+void CSIStubReaper::SetControlSurface(IReaperControlSurface *surface)
+{
+    s_surface = surface;
+}
+
+void CSIStubReaper::QueueMidiInput(int port, unsigned char status, unsigned char data1, unsigned char data2)
+{
+    auto it = s_midiInputs.find(port);
+
+    if (it != s_midiInputs.end())
+        it->second->Queue(status, data1, data2);
+}
+
+void CSIStubReaper::SetIsPlaying(bool isPlaying)
+{
+    s_isPlaying = isPlaying;
+}
+
+void CSIStubReaper::Tick()
+{
+    s_frame++;
+}
+
+MediaTrack *CSIStubReaper::GetTrack(int trackNumber)
+{
+    return trackNumber >= 0 && trackNumber < (int)s_tracks.size() ? ToMediaTrack(s_tracks[trackNumber].get()) : NULL;
+}
+
+int CSIStubReaper::GetNumTracks()
+{
+    return (int)s_tracks.size() - 1;
+}
+
+long long CSIStubReaper::GetNumAPICalls()
+{
+    return s_numAPICalls;
+}
+
+int CSIStubReaper::GetNumMessageBoxes()
+{
+    return s_numMessageBoxes;
+}
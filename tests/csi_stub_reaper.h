@@ -0,0 +1,42 @@
+//
+//  csi_stub_reaper.h
+//  csi_bench
+//
+//
+
+#ifndef csi_stub_reaper_h
+#define csi_stub_reaper_h
+
+#include "control_surface_integrator.h"
+
+// FX slot i on every track is an instance of s_stubFXNames[i % s_numStubFXNames]
+static const char * const s_stubFXNames[] = { "VST: BenchEQ (CSI)", "VST: BenchComp (CSI)" };
+static const int s_numStubFXNames = 2;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class CSIStubReaper
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+{
+public:
+    // stands in for the REAPER and SWELL entry points the CSI core calls, with a synthetic project of numTracks tracks,
+    // each with numFXPerTrack FX of numParamsPerFX params, MIDI devices are in memory, entry points nothing reaches stay NULL
+    static void Install(const char *resourcePath, int numTracks, int numFXPerTrack, int numParamsPerFX);
+
+    // REAPER calls back into the registered surface, track selection, volume, FX focus and the refresh command
+    static void SetControlSurface(IReaperControlSurface *surface);
+
+    // delivered on the next SwapBufs of the input device on port, as if the surface sent it
+    static void QueueMidiInput(int port, unsigned char status, unsigned char data1, unsigned char data2);
+
+    // the transport is stopped by default, playing moves the meters every tick
+    static void SetIsPlaying(bool isPlaying);
+    static void Tick();
+
+    static MediaTrack *GetTrack(int trackNumber); // 1 based, 0 = master
+    static int GetNumTracks();
+
+    static long long GetNumAPICalls();
+    static int GetNumMessageBoxes(); // CSI puts config errors up in a MessageBox
+};
+
+#endif /* csi_stub_reaper_h */
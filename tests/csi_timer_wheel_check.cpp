@@ -0,0 +1,82 @@
+//
+//  csi_timer_wheel_check.cpp
+//  csi_timer_wheel_check
+//
+//  Checks that a timer armed N ms out on CSITimerWheel fires within one slot of N,
+//  for a range of N, for every phase within a slot, and across the GetTickCount wrap
+//
+
+#include "csi_stub_reaper.h"
+
+static const DWORD s_delays[] = { 0, 1, 5, 15, 16, 17, 31, 33, 100, 250, 500, 1000, 1023, 1024, 1025, 1500, 3000 };
+
+static const DWORD s_startTimes[] = { 1000000, 0xFFFFFF00, 0xFFFFFFF8 }; // the last two wrap while the timer is pending
+
+int main()
+{
+    const filesystem::path resourceFolder = filesystem::temp_directory_path() / ("csi_timer_wheel_check_" + to_string(GetProfilerMicroseconds()));
+
+    CSIStubReaper::Install(resourceFolder.string().c_str(), 1, 0, 0);
+
+    int numChecks = 0;
+    int numFailures = 0;
+
+    {
+        CSurfIntegrator *csi = new CSurfIntegrator();
+
+        // a Zone that was never activated, so firing runs no actions
+        Widget widget(csi, NULL, "Button");
+        Zone zone(csi, NULL, NULL, 0, "TimerWheelCheck", "TimerWheelCheck", "");
+        ActionContext context(csi, csi->GetAction("NoAction"), &widget, &zone, 0, { "NoAction" });
+
+        const DWORD slotMs = CSITimerWheel::GetSlotMs();
+
+        for (DWORD startTime : s_startTimes)
+        {
+            for (DWORD phase = 0; phase < slotMs; ++phase)
+            {
+                for (DWORD delay : s_delays)
+                {
+                    numChecks++;
+
+                    const DWORD armTime = startTime + phase;
+                    const DWORD dueTime = armTime + delay;
+
+                    CSITimerWheel timerWheel;
+                    timerWheel.Run(armTime);
+                    timerWheel.Arm(&context, dueTime);
+
+                    // Run every ms the way the surfaces do, give up well past one wheel turn late
+                    DWORD now = armTime;
+                    while (timerWheel.GetNumTimers() > 0 && now - armTime < delay + 2000)
+                        timerWheel.Run(++now);
+
+                    if (timerWheel.GetNumTimers() > 0)
+                    {
+                        numFailures++;
+                        printf("armed at %u for +%u ms: not fired after %u ms\n", armTime, delay, now - armTime);
+                        timerWheel.Cancel(&context);
+                        continue;
+                    }
+
+                    const int lateness = (int)(now - dueTime);
+
+                    if (lateness < 0 || lateness > (int)slotMs)
+                    {
+                        numFailures++;
+                        printf("armed at %u for +%u ms: fired after %u ms, %d ms late\n", armTime, delay, now - armTime, lateness);
+                    }
+                }
+            }
+        }
+
+        delete csi;
+    }
+
+    error_code ec;
+    filesystem::remove_all(resourceFolder, ec);
+
+    printf("csi_timer_wheel_check: %d timers, %d fired outside one %u ms slot of their due time\n", numChecks, numFailures, CSITimerWheel::GetSlotMs());
+
+    return numFailures == 0 ? 0 : 1;
+}
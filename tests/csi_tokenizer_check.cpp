@@ -0,0 +1,212 @@
+//
+//  csi_tokenizer_check.cpp
+//  csi_tokenizer_check
+//
+//  Checks the in place TrimLine and GetTokens against the stream based versions they replaced,
+//  over every line of every config file in a CSI folder and a set of edge case lines
+//
+
+#include "control_surface_integrator.h" // links against the stub core for TrimLine and GetTokens
+
+static const char * const s_configFileExtensions[] = { ".ini", ".mst", ".ost", ".zon", ".txt" };
+
+static const char * const s_edgeCaseLines[] =
+{
+    "",
+    "   ",
+    "\t \r",
+    "Version=7.0",
+    "Zone \"Home\"",
+    "Zone \"VST: ReaEQ (Cockos)\" \"ReaEQ\"",
+    "  Fader1   TrackVolume  // trailing comment",
+    "/ a single slash comments out the line",
+    "// so do two",
+    "a//b c",
+    "a / b",
+    "Widget   Fader1\tRotaryWidgetClass",
+    "\tFB_MCUDisplayUpper 0\r",
+    "Shift+Control+Fader1 TrackVolume",
+    "Toggle+Hold+Mute| TrackMute",
+    "+Fader1 ++ a+ +",
+    "\"\"",
+    "x \"\" y",
+    "\"quoted with \\\"escapes\\\" and \\\\ inside\" next",
+    "\"unterminated quote",
+    "ok \"trailing backslash\\",
+    "\"quote\"glued",
+    "glued\"quote\"",
+    "SurfaceType=MIDI SurfaceName=\"X Touch One\" SurfaceChannelCount=8",
+    "a\vb\fc\nd",
+    "caf\xc3\xa9 \xe2\x80\x94 \xe2\x80\x9cutf8\xe2\x80\x9d",
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reference, the stream based versions TrimLine and GetTokens replaced
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void ReferenceTrimLine(string &line)
+{
+    const string tmp = line;
+    const char *p = tmp.c_str();
+
+    line.clear();
+    for (;;)
+    {
+        while (*p > 0 && isspace(*p))
+            p++;
+
+        if (!*p || p[0] == '/') break;
+
+        if (line.length())
+            line.append(" ",1);
+
+        while (*p && (*p < 0 || !isspace(*p)))
+        {
+           if (p[0] == '/' && p[1] == '/') break;
+           line.append(p++,1);
+        }
+    }
+}
+
+static void ReferenceGetTokens(vector<string> &tokens, const string &line)
+{
+    istringstream iss(line);
+    string token;
+    while (iss >> quoted(token))
+        tokens.push_back(token);
+}
+
+static void ReferenceGetTokens(vector<string> &tokens, const string &line, char delimiter)
+{
+    istringstream iss(line);
+    string token;
+    while (getline(iss, token, delimiter))
+        tokens.push_back(token);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+static string JoinTokens(const vector<string> &tokens)
+{
+    string joined;
+
+    for (const string &token : tokens)
+        joined += "[" + token + "]";
+
+    return joined;
+}
+
+struct CSITokenizerCheck
+{
+    int numLines = 0;
+    int numMismatches = 0;
+
+    void Mismatch(const char *source, int lineNumber, const char *function, const string &line, const string &expected, const string &actual)
+    {
+        numMismatches++;
+        printf("%s:%d: %s mismatch in '%s'\n    expected %s\n    actual   %s\n", source, lineNumber, function, line.c_str(), expected.c_str(), actual.c_str());
+    }
+
+    void CheckTokens(const char *source, int lineNumber, const string &line)
+    {
+        vector<string> expected;
+        ReferenceGetTokens(expected, line);
+
+        // GetTokens appends, so start from a non empty vector the way the zone loader reuses its buffers
+        vector<string> actual = { "previous" };
+        GetTokens(actual, line);
+        actual.erase(actual.begin());
+
+        if (actual != expected)
+            Mismatch(source, lineNumber, "GetTokens", line, JoinTokens(expected), JoinTokens(actual));
+
+        // widget names are split on + into modifiers
+        if (expected.size() > 0)
+        {
+            vector<string> expectedModifiers;
+            ReferenceGetTokens(expectedModifiers, expected[0], '+');
+
+            vector<string> actualModifiers;
+            GetTokens(actualModifiers, expected[0], '+');
+
+            if (actualModifiers != expectedModifiers)
+                Mismatch(source, lineNumber, "GetTokens('+')", expected[0], JoinTokens(expectedModifiers), JoinTokens(actualModifiers));
+        }
+    }
+
+    void CheckLine(const char *source, int lineNumber, const string &line)
+    {
+        numLines++;
+
+        string expected = line;
+        ReferenceTrimLine(expected);
+
+        string actual = line;
+        TrimLine(actual);
+
+        if (actual != expected)
+            Mismatch(source, lineNumber, "TrimLine", line, "'" + expected + "'", "'" + actual + "'");
+
+        // the loaders tokenize trimmed lines, a few places tokenize lines as they are
+        CheckTokens(source, lineNumber, expected);
+        CheckTokens(source, lineNumber, line);
+    }
+};
+
+static bool IsConfigFile(const filesystem::path &path)
+{
+    for (const char *extension : s_configFileExtensions)
+        if (path.extension() == extension)
+            return true;
+
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: csi_tokenizer_check [CSI folder]\n");
+        return 2;
+    }
+
+    CSITokenizerCheck check;
+
+    for (int i = 0; i < (int)(sizeof(s_edgeCaseLines) / sizeof(s_edgeCaseLines[0])); ++i)
+        check.CheckLine("edge cases", i + 1, s_edgeCaseLines[i]);
+
+    const filesystem::path csiFolder = argc > 1 ? argv[1] : "CSI";
+
+    int numFiles = 0;
+    error_code ec;
+
+    if (filesystem::is_directory(csiFolder, ec))
+    {
+        for (auto &entry : filesystem::recursive_directory_iterator(csiFolder, ec))
+        {
+            if ( ! entry.is_regular_file() || ! IsConfigFile(entry.path()))
+                continue;
+
+            numFiles++;
+
+            const string source = entry.path().string();
+            ifstream file(entry.path(), ios::binary);
+
+            int lineNumber = 0;
+
+            for (string line; getline(file, line); )
+                check.CheckLine(source.c_str(), ++lineNumber, line);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "csi_tokenizer_check: %s is not a folder\n", csiFolder.string().c_str());
+        return 2;
+    }
+
+    printf("csi_tokenizer_check: %d lines in %d config files under %s plus %d edge cases, %d mismatches\n",
+           check.numLines - (int)(sizeof(s_edgeCaseLines) / sizeof(s_edgeCaseLines[0])), numFiles, csiFolder.string().c_str(),
+           (int)(sizeof(s_edgeCaseLines) / sizeof(s_edgeCaseLines[0])), check.numMismatches);
+
+    return check.numMismatches == 0 ? 0 : 1;
+}